@@ -0,0 +1,1293 @@
+/**
+ * @brief Microbenchmarks for the rules plugin hot paths
+ *
+ * Built with -DRULES_PLUGIN_BUILD_BENCHMARKS=ON. Results are Qt Test
+ * benchmark output; use the run-rules-bench target (or pass
+ * "-o rules-bench.xml,xml") for machine-readable results.
+ */
+
+#include "rules_service.h"
+#include "rule_model.h"
+#include "demo_service.h"
+#include "payload_codec.h"
+#include "plugin_log.h"
+#include "window_aggregator.h"
+#include "rule_expression.h"
+#include "rule_set.h"
+#include "epoch.h"
+#include "sharded_checker.h"
+#include "work_stealing_pool.h"
+#include "event_scheduler.h"
+#include "result_publisher.h"
+#include "rules_service_api.h"
+#include "rule_bulk_io.h"
+#include "rules_metrics.h"
+#include "outbound_http.h"
+
+#include <QtTest>
+#include <QBuffer>
+#include <QJSEngine>
+#include <QNetworkAccessManager>
+#include <QNetworkProxy>
+#include <QNetworkReply>
+#include <QRandomGenerator>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <cstdlib>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace rules;
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+
+// Counts every heap allocation in the process, Qt's included (QArrayData
+// allocates with malloc, not operator new), by interposing on glibc's
+// allocator entry points. Counting is off unless an AllocationCounter is
+// alive, so other benchmarks pay one relaxed load per call, not a shared
+// atomic increment.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+}
+
+namespace {
+std::atomic<bool> g_countAllocations{false};
+std::atomic<quint64> g_allocations{0};
+
+inline void countAllocation()
+{
+    if (g_countAllocations.load(std::memory_order_relaxed)) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+}
+
+extern "C" void* malloc(size_t size)
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+    countAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void* ptr)
+{
+    __libc_free(ptr);
+}
+#endif
+
+namespace {
+
+// Enables allocation counting for its lifetime (allocationChurn only)
+class AllocationCounter
+{
+public:
+    AllocationCounter()
+    {
+#if defined(__GLIBC__)
+        g_countAllocations.store(true, std::memory_order_relaxed);
+#endif
+    }
+    ~AllocationCounter()
+    {
+#if defined(__GLIBC__)
+        g_countAllocations.store(false, std::memory_order_relaxed);
+#endif
+    }
+    Q_DISABLE_COPY(AllocationCounter)
+};
+
+quint64 allocationCount()
+{
+#if defined(__GLIBC__)
+    return g_allocations.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
+// Resident set size vs bytes the allocator has handed out; the gap is
+// fragmentation plus allocator overhead
+void reportMemory(const char* label)
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    QFile statm("/proc/self/statm");
+    qint64 rssPages = 0;
+    if (statm.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> fields = statm.readAll().split(' ');
+        rssPages = fields.value(1).toLongLong();
+    }
+    const struct mallinfo2 info = mallinfo2();
+    const double rssMb = rssPages * 4096 / 1e6;
+    const double inUseMb = (info.uordblks + info.hblkhd) / 1e6;
+    qInfo("%s: RSS %.1f MB, heap in use %.1f MB, free in heap %.1f MB",
+          label, rssMb, inUseMb, info.fordblks / 1e6);
+#else
+    Q_UNUSED(label);
+#endif
+}
+
+QVariantMap sampleRule(int i)
+{
+    static const char* const statuses[] = {"pending", "processing", "shipped", "delivered", "cancelled"};
+    return {
+        {"customerName", QString("Customer %1").arg(i % 1000)},
+        {"productName", QString("Product %1").arg(i % 100)},
+        {"quantity", 1 + i % 10},
+        {"price", 9.99 + (i % 50)},
+        {"status", statuses[i % 5]}
+    };
+}
+
+QByteArray jsonBody(qsizetype targetBytes)
+{
+    QByteArray body = "[";
+    for (int i = 0; body.size() < targetBytes; ++i) {
+        if (i > 0) body += ',';
+        body += QString(R"({"id":%1,"customerName":"Customer %2","amount":%3,"tags":["a","b","c"]})")
+                    .arg(i).arg(i % 1000).arg(i * 1.5).toUtf8();
+    }
+    body += ']';
+    return body;
+}
+
+// Local HTTP stand-in: answers every request after a random delay, a
+// fraction of them from a slow tail, so hedging has something to cut
+class DelayServer
+{
+public:
+    explicit DelayServer(double slowFraction)
+        : m_slowFraction(slowFraction)
+        , m_random(42)
+    {
+        QObject::connect(&m_server, &QTcpServer::newConnection, &m_server, [this]() {
+            while (QTcpSocket* socket = m_server.nextPendingConnection()) {
+                QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket]() { serve(socket); });
+                QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            }
+        });
+    }
+
+    bool listen() { return m_server.listen(QHostAddress::LocalHost); }
+    QUrl url() const { return QUrl(QString("http://127.0.0.1:%1/").arg(m_server.serverPort())); }
+
+private:
+    void serve(QTcpSocket* socket)
+    {
+        // Bodiless GETs: a request ends at the blank line
+        QByteArray buffer = socket->property("request").toByteArray() + socket->readAll();
+        for (qsizetype end = buffer.indexOf("\r\n\r\n"); end >= 0; end = buffer.indexOf("\r\n\r\n")) {
+            buffer.remove(0, end + 4);
+            const int delayMs = m_random.bounded(1.0) < m_slowFraction ? m_random.bounded(150, 300)
+                                                                       : m_random.bounded(2, 10);
+            // Dropped with the socket when the client aborts (hedge loser)
+            QTimer::singleShot(delayMs, socket, [socket]() {
+                socket->write("HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 2\r\n\r\nok");
+            });
+        }
+        socket->setProperty("request", buffer);
+    }
+
+    QTcpServer m_server;
+    double m_slowFraction;
+    QRandomGenerator m_random;
+};
+
+} // namespace
+
+class RulesBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void crudCycle_data() { addSizes(); }
+    void crudCycle();
+    void getRule_data() { addSizes(); }
+    void getRule();
+    void getAllRules_data() { addSizes(); }
+    void getAllRules();
+    void getRulesByStatus_data() { addSizes(); }
+    void getRulesByStatus();
+    void getTotalRevenue_data() { addSizes(); }
+    void getTotalRevenue();
+    void modelRefresh_data() { addSizes(); }
+    void modelRefresh();
+    void modelFilterStall_data() { addSizes(); }
+    void modelFilterStall();
+    void modelEdit_data() { addSizes(); }
+    void modelEdit();
+    void recentRules_data();
+    void recentRules();
+    void modelDataViewport_data() { addSizes(); }
+    void modelDataViewport();
+    void ruleToVariantMap();
+    void demoOnEventReceived_data();
+    void demoOnEventReceived();
+    void payloadDecodeBlocking_data() { addBodySizes(); }
+    void payloadDecodeBlocking();
+    void payloadDecodeCallerStall_data() { addBodySizes(); }
+    void payloadDecodeCallerStall();
+    void windowAggregate_data();
+    void windowAggregate();
+    void conditionVm_data() { addConditions(); }
+    void conditionVm();
+    void conditionQmlJs_data() { addConditions(); }
+    void conditionQmlJs();
+    void ruleSetHotSwap();
+    void shardedScaling_data();
+    void shardedScaling();
+    void schedulerOverload_data();
+    void schedulerOverload();
+    void memoReplay_data();
+    void memoReplay();
+    void resultPayload_data();
+    void resultPayload();
+    void rulesInterface_data();
+    void rulesInterface();
+    void bulkImport_data();
+    void bulkImport();
+    void bulkExport_data();
+    void bulkExport();
+    void handoffReload_data() { addSizes(); }
+    void handoffReload();
+    void hedgedTail_data();
+    void hedgedTail();
+    void allocationChurn();
+
+private:
+    void addConditions();
+    void addSizes();
+    void addBodySizes();
+    RulesService* service(int size);
+
+    // Populating 1M rules is expensive, so each size is built once
+    std::map<int, std::unique_ptr<RulesService>> m_services;
+};
+
+void RulesBench::addSizes()
+{
+    QTest::addColumn<int>("size");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("100k") << 100000;
+    QTest::newRow("1M") << 1000000;
+}
+
+void RulesBench::addBodySizes()
+{
+    QTest::addColumn<QByteArray>("body");
+    QTest::newRow("1MB") << jsonBody(1 << 20);
+    QTest::newRow("10MB") << jsonBody(10 << 20);
+    QTest::newRow("50MB") << jsonBody(50 << 20);
+}
+
+RulesService* RulesBench::service(int size)
+{
+    auto& slot = m_services[size];
+    if (!slot) {
+        slot = std::make_unique<RulesService>();
+        for (int i = 0; i < size; ++i) {
+            slot->createRule(sampleRule(i));
+        }
+    }
+    return slot.get();
+}
+
+void RulesBench::crudCycle()
+{
+    QFETCH(int, size);
+    RulesService* rules = service(size);
+    const QVariantMap data = sampleRule(size);
+
+    // Create, read, update and delete one rule; the store size stays constant
+    QBENCHMARK {
+        QString id = rules->createRule(data);
+        rules->getRule(id);
+        rules->updateRule(id, {{"quantity", 2}});
+        rules->deleteRule(id);
+    }
+}
+
+void RulesBench::getRule()
+{
+    QFETCH(int, size);
+    RulesService* rules = service(size);
+    const QString id = rules->getAllRules().at(size / 2).toMap().value("id").toString();
+
+    QBENCHMARK {
+        rules->getRule(id);
+    }
+}
+
+void RulesBench::getAllRules()
+{
+    QFETCH(int, size);
+    RulesService* rules = service(size);
+
+    QBENCHMARK {
+        rules->getAllRules();
+    }
+}
+
+void RulesBench::getRulesByStatus()
+{
+    QFETCH(int, size);
+    RulesService* rules = service(size);
+
+    QBENCHMARK {
+        rules->getRulesByStatus("shipped");
+    }
+}
+
+void RulesBench::getTotalRevenue()
+{
+    QFETCH(int, size);
+    RulesService* rules = service(size);
+
+    QBENCHMARK {
+        rules->getTotalRevenue();
+    }
+}
+
+void RulesBench::modelRefresh()
+{
+    QFETCH(int, size);
+    RuleModel model(service(size));
+    QTRY_VERIFY_WITH_TIMEOUT(!model.loading(), 60000);
+
+    // Until the rows are swapped in; large stores build them on a worker
+    QBENCHMARK {
+        model.refresh();
+        QTRY_VERIFY_WITH_TIMEOUT(!model.loading(), 60000);
+    }
+}
+
+void RulesBench::modelFilterStall()
+{
+    // How long a filter change holds the GUI thread, and how long until
+    // the new rows are in
+    QFETCH(int, size);
+    RuleModel model(service(size));
+    QTRY_VERIFY_WITH_TIMEOUT(!model.loading(), 60000);
+
+    QElapsedTimer elapsed;
+    qint64 stallNs = 0;
+    qint64 totalNs = 0;
+    int rounds = 0;
+    QBENCHMARK {
+        elapsed.start();
+        model.setFilterStatus(rounds % 2 ? "pending" : "shipped");
+        stallNs += elapsed.nsecsElapsed();
+        QTRY_VERIFY_WITH_TIMEOUT(!model.loading(), 60000);
+        totalNs += elapsed.nsecsElapsed();
+        ++rounds;
+    }
+    qInfo("%d rules: GUI thread blocked %.2f ms per filter change, rows ready after %.2f ms",
+          size, stallNs / 1e6 / rounds, totalNs / 1e6 / rounds);
+}
+
+void RulesBench::modelEdit()
+{
+    // One edit through the change feed; before it the model reset and
+    // re-read every rule on each rulesChanged
+    QFETCH(int, size);
+    RulesService* rules = service(size);
+    RuleModel model(rules);
+    QTRY_VERIFY_WITH_TIMEOUT(!model.loading(), 60000);
+    const QString id = model.get(size / 2).value("id").toString();
+    const quint64 resetsBefore = RulesMetrics::counters().modelResets.load();
+
+    int quantity = 0;
+    QBENCHMARK {
+        rules->updateRule(id, {{"quantity", 1 + quantity++ % 10}});
+    }
+    QCOMPARE(RulesMetrics::counters().modelResets.load(), resetsBefore);
+}
+
+void RulesBench::recentRules_data()
+{
+    QTest::addColumn<int>("size");
+    QTest::addColumn<bool>("indexed");
+    const std::pair<const char*, int> sizes[] = {{"1k", 1000}, {"100k", 100000}, {"1M", 1000000}};
+    for (const auto& [label, size] : sizes) {
+        QTest::addRow("%s/scanSort", label) << size << false;
+        QTest::addRow("%s/index", label) << size << true;
+    }
+}
+
+void RulesBench::recentRules()
+{
+    // "Newest 50 by updatedAt": sorting a full copy vs the time index
+    QFETCH(int, size);
+    QFETCH(bool, indexed);
+    RulesService* rules = service(size);
+
+    QBENCHMARK {
+        if (indexed) {
+            rules->recentRules(RulesService::TimeField::UpdatedAt, 50);
+        } else {
+            QList<Rule> all = rules->rules();
+            std::partial_sort(all.begin(), all.begin() + qMin<qsizetype>(50, all.size()), all.end(),
+                [](const Rule& a, const Rule& b) { return a.updatedAt > b.updatedAt; });
+            all.resize(qMin<qsizetype>(50, all.size()));
+        }
+    }
+}
+
+void RulesBench::modelDataViewport()
+{
+    QFETCH(int, size);
+    RuleModel model(service(size));
+    QTRY_VERIFY_WITH_TIMEOUT(!model.loading(), 60000);
+    const QList<int> roles = model.roleNames().keys();
+
+    // What a ListView asks for when showing ~50 rows
+    QBENCHMARK {
+        for (int row = 0; row < 50; ++row) {
+            const QModelIndex index = model.index(row);
+            for (int role : roles) {
+                model.data(index, role);
+            }
+        }
+    }
+}
+
+void RulesBench::ruleToVariantMap()
+{
+    Rule rule = Rule::fromVariantMap(sampleRule(42));
+    rule.id = "abcd1234";
+    rule.createdAt = QDateTime::currentDateTime();
+    rule.updatedAt = rule.createdAt;
+
+    QBENCHMARK {
+        rule.toVariantMap();
+    }
+}
+
+void RulesBench::demoOnEventReceived_data()
+{
+    QTest::addColumn<int>("logLevel");
+    QTest::newRow("debugOff") << static_cast<int>(log::Level::Info);
+    QTest::newRow("debugOn") << static_cast<int>(log::Level::Debug);
+}
+
+void RulesBench::demoOnEventReceived()
+{
+    QFETCH(int, logLevel);
+    const log::Level previous = log::level();
+    log::setLevel(static_cast<log::Level>(logLevel));
+
+    DemoService demo("com.biiz.rules");
+    const QVariantMap data = {{"message", "hello"}, {"orderId", "o-1"}, {"totalAmount", 120.5}};
+
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i) {
+            demo.onEventReceived("demo/rules/message", data, "com.biiz.orders");
+        }
+    }
+
+    log::flush();
+    log::setLevel(previous);
+}
+
+void RulesBench::payloadDecodeBlocking()
+{
+    QFETCH(QByteArray, body);
+
+    // Cost the GUI thread paid when responses were decoded inline
+    QBENCHMARK {
+        PayloadCodec::decodeNow(body, "application/json");
+    }
+}
+
+void RulesBench::payloadDecodeCallerStall()
+{
+    QFETCH(QByteArray, body);
+
+    // Caller-side cost of handing the body to the worker; the wait for the
+    // result is excluded, so this is the stall left on the GUI thread
+    qint64 best = std::numeric_limits<qint64>::max();
+    for (int run = 0; run < 5; ++run) {
+        QElapsedTimer timer;
+        timer.start();
+        QFuture<DecodedPayload> future = PayloadCodec::decode(body, "application/json");
+        best = std::min(best, timer.nsecsElapsed());
+        future.waitForFinished();
+    }
+    QTest::setBenchmarkResult(best, QTest::WalltimeNanoseconds);
+}
+
+void RulesBench::windowAggregate_data()
+{
+    QTest::addColumn<int>("maxKeys");
+    QTest::newRow("1M customers") << 1000000;
+    QTest::newRow("1M customers, 100k cap") << 100000;
+}
+
+void RulesBench::windowAggregate()
+{
+    QFETCH(int, maxKeys);
+    constexpr int CUSTOMERS = 1000000;
+    constexpr qint64 MINUTE_MS = 60 * 1000;
+
+    static const QStringList customers = []() {
+        QStringList keys;
+        keys.reserve(CUSTOMERS);
+        for (int i = 0; i < CUSTOMERS; ++i) {
+            keys.append(QString("customer-%1").arg(i));
+        }
+        return keys;
+    }();
+
+    // Same windows as RuleEngine
+    qint64 now = 1700000000000;
+    WindowAggregator aggregator({{"orders10m", WindowKind::Sliding, 10 * MINUTE_MS, 10},
+                                 {"ordersDaily", WindowKind::Tumbling, 24 * 60 * MINUTE_MS, 1}},
+                                static_cast<size_t>(maxKeys), now);
+    for (int i = 0; i < CUSTOMERS; ++i) {
+        aggregator.add(customers[i], 10.0 + i % 100, now);
+    }
+
+    // 100k events over random customers, 1 ms apart, with wheel ticks
+    quint32 seed = 12345;
+    QBENCHMARK {
+        for (int i = 0; i < 100000; ++i) {
+            seed = seed * 1664525u + 1013904223u;
+            now += 1;
+            aggregator.add(customers[static_cast<int>(seed % CUSTOMERS)], 25.0, now);
+            if (i % 1000 == 0) {
+                aggregator.advance(now);
+            }
+        }
+    }
+
+    qInfo("keys %zu, evicted %llu, ~%.1f MB (%.0f B/key)",
+          aggregator.keyCount(), static_cast<unsigned long long>(aggregator.evictedKeys()),
+          aggregator.memoryBytes() / 1048576.0,
+          double(aggregator.memoryBytes()) / std::max<size_t>(aggregator.keyCount(), 1));
+}
+
+void RulesBench::addConditions()
+{
+    // The condition language is a JS subset, so the same text runs in both
+    QTest::addColumn<QString>("condition");
+    QTest::newRow("compare") << QString("totalAmount > 10000");
+    QTest::newRow("compound") << QString(R"(totalAmount > 10000 && customer.tier != "gold")");
+    QTest::newRow("mixed") << QString(R"(quantity * price >= 500 || (status == "vip" && totalAmount > 100 * 2))");
+}
+
+void RulesBench::conditionVm()
+{
+    QFETCH(QString, condition);
+
+    expr::FieldTable table;
+    const expr::CompileResult compiled = expr::compile(condition, table);
+    QVERIFY2(compiled.program, qPrintable(compiled.error));
+
+    // Same field values as the QML JS case, bound once per event
+    std::vector<expr::Value> fields(static_cast<size_t>(table.size()));
+    auto bind = [&](const char* path, expr::Value value) {
+        const int slot = table.find(path);
+        if (slot >= 0) fields[static_cast<size_t>(slot)] = std::move(value);
+    };
+    bind("customer.tier", expr::Value::fromString("silver"));
+    bind("quantity", expr::Value::fromNumber(3));
+    bind("price", expr::Value::fromNumber(99.5));
+    bind("status", expr::Value::fromString("vip"));
+    const int amountSlot = table.find("totalAmount");
+
+    int matched = 0;
+    QBENCHMARK {
+        for (int i = 0; i < 10000; ++i) {
+            if (amountSlot >= 0) {
+                fields[static_cast<size_t>(amountSlot)] = expr::Value::fromNumber(i * 2.0);
+            }
+            matched += compiled.program->matches(fields.data()) ? 1 : 0;
+        }
+    }
+    QVERIFY(matched >= 0);
+}
+
+void RulesBench::conditionQmlJs()
+{
+    QFETCH(QString, condition);
+
+    QJSEngine engine;
+    QJSValue function = engine.evaluate(
+        QString("(function(totalAmount, customer, quantity, price, status) { return %1; })").arg(condition));
+    QVERIFY(function.isCallable());
+
+    QJSValue customer = engine.newObject();
+    customer.setProperty("tier", "silver");
+
+    int matched = 0;
+    QBENCHMARK {
+        for (int i = 0; i < 10000; ++i) {
+            const QJSValue result = function.call({QJSValue(i * 2.0), customer, QJSValue(3),
+                                                   QJSValue(99.5), QJSValue("vip")});
+            matched += result.toBool() ? 1 : 0;
+        }
+    }
+    QVERIFY(matched >= 0);
+}
+
+void RulesBench::ruleSetHotSwap()
+{
+    // Readers evaluate the current set continuously while the benchmark
+    // loop edits conditions; every edit triggers a background rebuild
+    RulesService rules;
+    QStringList ids;
+    for (int i = 0; i < 100; ++i) {
+        QVariantMap data = sampleRule(i);
+        data["status"] = "active";
+        data["condition"] = QString("totalAmount > %1 && quantity < %2").arg(i * 100).arg(i % 10 + 1);
+        ids.append(rules.createRule(data));
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<quint64> evaluations{0};
+    std::atomic<quint64> regressions{0};
+    std::vector<std::thread> readers;
+    const int readerCount = std::max(1, QThread::idealThreadCount() - 1);
+
+    for (int r = 0; r < readerCount; ++r) {
+        readers.emplace_back([&rules, &stop, &evaluations, &regressions]() {
+            quint64 lastVersion = 0;
+            quint64 local = 0;
+            std::vector<expr::Value> fields;
+            while (!stop.load(std::memory_order_relaxed)) {
+                epoch::Guard guard;
+                const CompiledRuleSet* set = rules.compiledRules().acquire();
+                if (set->version < lastVersion) {
+                    regressions.fetch_add(1, std::memory_order_relaxed);
+                }
+                lastVersion = set->version;
+
+                fields.assign(static_cast<size_t>(set->fields.size()), expr::Value::fromNumber(5000));
+                for (const CompiledRule& rule : set->rules) {
+                    rule.program->matches(fields.data());
+                    ++local;
+                }
+            }
+            evaluations.fetch_add(local, std::memory_order_relaxed);
+        });
+    }
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    const quint64 swapsBefore = rules.compiledRules().swapCount();
+    int edit = 0;
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i, ++edit) {
+            rules.updateRule(ids[edit % ids.size()],
+                             {{"condition", QString("totalAmount > %1").arg(edit)}});
+        }
+    }
+
+    stop.store(true);
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    QCOMPARE(regressions.load(), quint64(0));
+    qInfo("%d readers: %.1f M evaluations/s during edits, %llu set swaps for %d edits, %zu sets awaiting reclamation",
+          readerCount, evaluations.load() / (elapsed.nsecsElapsed() / 1e9) / 1e6,
+          static_cast<unsigned long long>(rules.compiledRules().swapCount() - swapsBefore), edit,
+          epoch::pendingCount());
+}
+
+void RulesBench::shardedScaling_data()
+{
+    QTest::addColumn<int>("threads");
+    for (int threads = 1; threads < QThread::idealThreadCount(); threads *= 2) {
+        QTest::addRow("%d threads", threads) << threads;
+    }
+    QTest::addRow("%d threads", QThread::idealThreadCount()) << QThread::idealThreadCount();
+}
+
+void RulesBench::shardedScaling()
+{
+    QFETCH(int, threads);
+
+    RulesService rules;
+    for (int i = 0; i < 100; ++i) {
+        QVariantMap data = sampleRule(i);
+        data["status"] = "active";
+        data["condition"] = QString(R"(totalAmount > %1 && (customer.tier != "gold" || window.orders10m.count > %2))")
+                                .arg(i * 100).arg(i % 10);
+        rules.createRule(data);
+    }
+    QTRY_COMPARE(rules.compiledRules().version(), quint64(100));
+
+    const std::vector<WindowSpec> windows = {{"orders10m", WindowKind::Sliding, 600000, 10}};
+    constexpr int customers = 10000;
+    constexpr int events = 100000;
+
+    // Per-customer results must come back in submit order
+    std::vector<int> lastSeen(customers, -1);
+    std::atomic<quint64> results{0};
+    std::atomic<quint64> outOfOrder{0};
+
+    WorkStealingPool pool(threads);
+    ShardedChecker checker(rules, pool, windows, threads * 8,
+        [&](const CheckResult& result) {
+            const int seq = result.orderId.toInt();
+            int& last = lastSeen[static_cast<size_t>(seq % customers)];
+            if (seq <= last) {
+                outOfOrder.fetch_add(1, std::memory_order_relaxed);
+            }
+            last = seq;
+            results.fetch_add(1, std::memory_order_relaxed);
+        });
+
+    std::vector<CheckRequest> requests(events);
+    for (int i = 0; i < events; ++i) {
+        CheckRequest& request = requests[static_cast<size_t>(i)];
+        request.orderId = QString::number(i);
+        request.customer = QString("Customer %1").arg(i % customers);
+        request.data = {{"totalAmount", (i % 200) * 50.0},
+                        {"customer", QVariantMap{{"tier", i % 3 ? "silver" : "gold"}}}};
+        request.windows = {WindowStats{static_cast<quint64>(i % 12), 0, 0, 0}};
+    }
+
+    QElapsedTimer elapsed;
+    qint64 elapsedNs = 0;
+    int rounds = 0;
+    QBENCHMARK {
+        std::fill(lastSeen.begin(), lastSeen.end(), -1);
+        elapsed.start();
+        for (const CheckRequest& request : requests) {
+            checker.submit(CheckRequest(request));
+        }
+        checker.waitForIdle();
+        elapsedNs += elapsed.nsecsElapsed();
+        ++rounds;
+    }
+
+    QCOMPARE(outOfOrder.load(), quint64(0));
+    QCOMPARE(results.load(), quint64(events) * rounds);
+    qInfo("%d threads: %.0f k events/s (100 rules each), %llu tasks stolen",
+          threads, double(events) * rounds / (elapsedNs / 1e9) / 1e3,
+          static_cast<unsigned long long>(pool.stolenCount()));
+}
+
+void RulesBench::schedulerOverload_data()
+{
+    QTest::addColumn<bool>("prioritized");
+    QTest::newRow("fifo") << false;
+    QTest::newRow("priority") << true;
+}
+
+void RulesBench::schedulerOverload()
+{
+    // A flooding publisher: 90% demo traffic, 10% orders/created, arriving
+    // twice as fast as the handler (20 us per event) can keep up
+    QFETCH(bool, prioritized);
+
+    EventScheduler scheduler("bench");
+    if (prioritized) {
+        scheduler.addClass({"orderChecks", {"orders/created"}, 0, 2000, 0, ShedPolicy::DropLowestPriority});
+        scheduler.addClass({"demo", {"demo/rules/"}, 2, 2000, 500, ShedPolicy::Sample, 10});
+    } else {
+        scheduler.addClass({"all", {"orders/created", "demo/rules/"}, 0, 4000, 0, ShedPolicy::DropOldest});
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    std::vector<qint64> criticalLatencyUs;
+    quint64 handled = 0;
+    connect(&scheduler, &EventScheduler::eventDispatched, this,
+            [&](const QString& topic, const QVariantMap& data, const QString&) {
+                if (topic == QLatin1String("orders/created")) {
+                    criticalLatencyUs.push_back((clock.nsecsElapsed() - data.value("t").toLongLong()) / 1000);
+                }
+                const qint64 until = clock.nsecsElapsed() + 20000;
+                while (clock.nsecsElapsed() < until) {}
+                ++handled;
+            });
+
+    quint64 sent = 0;
+    QBENCHMARK_ONCE {
+        for (int burst = 0; burst < 200; ++burst) {
+            // 500 events in ~5 ms, then one dispatch slice of 5 ms
+            for (int i = 0; i < 500; ++i, ++sent) {
+                const bool critical = sent % 10 == 0;
+                scheduler.submit(critical ? "orders/created" : "demo/rules/tick",
+                                 {{"t", clock.nsecsElapsed()}}, "flooder");
+                const qint64 until = clock.nsecsElapsed() + 10000;
+                while (clock.nsecsElapsed() < until) {}
+            }
+            QCoreApplication::processEvents();
+        }
+        while (scheduler.queued() > 0) {
+            QCoreApplication::processEvents();
+        }
+    }
+
+    std::sort(criticalLatencyUs.begin(), criticalLatencyUs.end());
+    auto percentile = [&criticalLatencyUs](double p) {
+        return criticalLatencyUs.empty()
+            ? qint64(-1) : criticalLatencyUs[static_cast<size_t>(p * (criticalLatencyUs.size() - 1))];
+    };
+    const QVariantMap stats = scheduler.stats();
+    quint64 shed = 0;
+    for (const QVariant& entry : stats) {
+        shed += entry.toMap().value("shed").toULongLong() + entry.toMap().value("expired").toULongLong();
+    }
+    qInfo("%s: orders/created p50 %lld us, p99 %lld us, %zu of %llu delivered; %llu handled, %llu shed",
+          prioritized ? "priority" : "fifo", percentile(0.5), percentile(0.99),
+          criticalLatencyUs.size(), static_cast<unsigned long long>(sent / 10),
+          static_cast<unsigned long long>(handled), static_cast<unsigned long long>(shed));
+}
+
+void RulesBench::memoReplay_data()
+{
+    QTest::addColumn<int>("memoEntries");
+    QTest::newRow("off") << 0;
+    QTest::newRow("on") << 65536;
+}
+
+void RulesBench::memoReplay()
+{
+    // Replays and retries: 100k events over 2000 distinct (customer, payload)
+    // combinations, so most evaluations repeat earlier inputs
+    QFETCH(int, memoEntries);
+
+    RulesService rules;
+    for (int i = 0; i < 100; ++i) {
+        QVariantMap data = sampleRule(i);
+        data["status"] = "active";
+        data["condition"] = QString(R"(totalAmount > %1 && (customer.tier != "gold" || window.orders10m.count > %2))")
+                                .arg(i * 100).arg(i % 10);
+        rules.createRule(data);
+    }
+    QTRY_COMPARE(rules.compiledRules().version(), quint64(100));
+
+    const std::vector<WindowSpec> windows = {{"orders10m", WindowKind::Sliding, 600000, 10}};
+    WorkStealingPool pool;
+    ShardedChecker checker(rules, pool, windows, pool.threadCount() * 8, nullptr, nullptr,
+                           static_cast<size_t>(memoEntries));
+
+    constexpr int events = 100000;
+    std::vector<CheckRequest> requests(events);
+    for (int i = 0; i < events; ++i) {
+        const int distinct = i % 2000;
+        CheckRequest& request = requests[static_cast<size_t>(i)];
+        request.orderId = QString::number(i);
+        request.customer = QString("Customer %1").arg(distinct % 500);
+        request.data = {{"totalAmount", distinct * 5.0},
+                        {"customer", QVariantMap{{"tier", distinct % 3 ? "silver" : "gold"}}}};
+        request.windows = {WindowStats{static_cast<quint64>(distinct % 7), 0, 0, 0}};
+    }
+
+    MetricCounters& counters = RulesMetrics::counters();
+    const quint64 hitsBefore = counters.memoHits.load();
+    const quint64 missesBefore = counters.memoMisses.load();
+    const quint64 savedBefore = counters.memoSavedNs.load();
+
+    QElapsedTimer elapsed;
+    qint64 elapsedNs = 0;
+    int rounds = 0;
+    QBENCHMARK {
+        elapsed.start();
+        for (const CheckRequest& request : requests) {
+            checker.submit(CheckRequest(request));
+        }
+        checker.waitForIdle();
+        elapsedNs += elapsed.nsecsElapsed();
+        ++rounds;
+    }
+
+    const quint64 hits = counters.memoHits.load() - hitsBefore;
+    const quint64 lookups = hits + counters.memoMisses.load() - missesBefore;
+    qInfo("memo %s: %.0f k events/s, hit rate %.1f%%, ~%.1f ms evaluation saved",
+          memoEntries > 0 ? "on" : "off", double(events) * rounds / (elapsedNs / 1e9) / 1e3,
+          lookups > 0 ? 100.0 * hits / lookups : 0.0,
+          (counters.memoSavedNs.load() - savedBefore) / 1e6);
+}
+
+void RulesBench::resultPayload_data()
+{
+    QTest::addColumn<bool>("batched");
+    QTest::newRow("perOrder") << false;
+    QTest::newRow("columnar") << true;
+}
+
+void RulesBench::resultPayload()
+{
+    // Payload construction for 256 results (one default batch), ~20% of
+    // orders failing one of a few rules. Bus matching cost per publish
+    // comes on top of this for every per-order event.
+    QFETCH(bool, batched);
+
+    std::vector<CheckResult> results(256);
+    for (size_t i = 0; i < results.size(); ++i) {
+        CheckResult& result = results[i];
+        result.orderId = QString("order-%1").arg(i);
+        result.checkedAt = 1700000000000 + static_cast<qint64>(i);
+        if (i % 5 == 0) {
+            result.matchedRules = {QString("rule-%1").arg(i % 3)};
+            result.reasons = {QString("Rule %1").arg(i % 3)};
+        }
+    }
+
+    qsizetype payloads = 0;
+    QBENCHMARK {
+        if (batched) {
+            payloads += ResultPublisher::encode(results).size();
+        } else {
+            for (const CheckResult& result : results) {
+                const QVariantMap payload{
+                    {"orderId", result.orderId},
+                    {"passed", result.matchedRules.isEmpty()},
+                    {"matchedRules", result.matchedRules},
+                    {"reason", result.reasons.join(QStringLiteral(", "))},
+                    {"checkedAt", result.checkedAt}
+                };
+                payloads += payload.size();
+            }
+        }
+    }
+    QVERIFY(payloads > 0);
+
+    // The splitter must reproduce the per-order payloads
+    const QList<QVariantMap> split = ResultPublisher::split(ResultPublisher::encode(results));
+    QCOMPARE(split.size(), qsizetype(results.size()));
+    QCOMPARE(split[5].value("matchedRules").toStringList(), results[5].matchedRules);
+    QCOMPARE(split[6].value("passed").toBool(), true);
+}
+
+void RulesBench::rulesInterface_data()
+{
+    QTest::addColumn<bool>("typed");
+    QTest::newRow("eventBusPath") << false;
+    QTest::newRow("direct") << true;
+}
+
+void RulesBench::rulesInterface()
+{
+    // 1000 orders against 100 rules, either as one IRulesService::evaluate()
+    // call or the way an EventBus round trip carries them: a request map
+    // per order, decoded on the rules side, and a result map back. Bus
+    // routing and queued delivery come on top of eventBusPath.
+    QFETCH(bool, typed);
+
+    RulesService rules;
+    for (int i = 0; i < 100; ++i) {
+        QVariantMap data = sampleRule(i);
+        data["status"] = "active";
+        data["condition"] = QString(R"(totalAmount > %1 && status != "cancelled")").arg(i * 50);
+        rules.createRule(data);
+    }
+    QTRY_COMPARE(rules.compiledRules().version(), quint64(100));
+    RulesServiceApi api(&rules, [&rules]() { return &rules; });
+
+    constexpr int count = 1000;
+    QStringList orderIds;
+    QStringList customers;
+    for (int i = 0; i < count; ++i) {
+        orderIds.append(QString("order-%1").arg(i));
+        customers.append(QString("Customer %1").arg(i % 100));
+    }
+    const QString status = QStringLiteral("pending");
+
+    std::vector<OrderRecord> orders(count);
+    for (int i = 0; i < count; ++i) {
+        orders[static_cast<size_t>(i)] = {orderIds[i], customers[i], status,
+                                          (i % 200) * 30.0, 1 + i % 5, (i % 200) * 6.0};
+    }
+    std::vector<EvaluationResult> results(count);
+    std::vector<QString> matches;
+
+    quint64 matched = 0;
+    QBENCHMARK {
+        matches.clear();
+        if (typed) {
+            api.evaluate(orders.data(), count, results.data(), matches);
+            matched += matches.size();
+        } else {
+            for (int i = 0; i < count; ++i) {
+                const OrderRecord& order = orders[static_cast<size_t>(i)];
+                const QVariantMap request{
+                    {"orderId", order.orderId.toString()},
+                    {"customerName", order.customerName.toString()},
+                    {"status", order.status.toString()},
+                    {"totalAmount", order.totalAmount},
+                    {"quantity", order.quantity},
+                    {"price", order.price}
+                };
+
+                const QString orderId = request.value("orderId").toString();
+                const QString customerName = request.value("customerName").toString();
+                const QString orderStatus = request.value("status").toString();
+                const OrderRecord decoded{orderId, customerName, orderStatus,
+                                          request.value("totalAmount").toDouble(),
+                                          request.value("quantity").toInt(),
+                                          request.value("price").toDouble()};
+                EvaluationResult result;
+                const size_t first = matches.size();
+                api.evaluate(&decoded, 1, &result, matches);
+
+                QStringList matchedRules;
+                for (size_t m = first; m < matches.size(); ++m) {
+                    matchedRules.append(matches[m]);
+                }
+                const QVariantMap reply{
+                    {"orderId", orderId},
+                    {"passed", result.passed()},
+                    {"matchedRules", matchedRules}
+                };
+                matched += static_cast<quint64>(reply.value("matchedRules").toStringList().size());
+            }
+        }
+    }
+    QVERIFY(matched > 0);
+}
+
+void RulesBench::bulkImport_data()
+{
+    QTest::addColumn<QString>("mode");
+    QTest::newRow("createRule") << "createRule";
+    QTest::newRow("jsonl") << "jsonl";
+    QTest::newRow("csv") << "csv";
+}
+
+void RulesBench::bulkImport()
+{
+    // A 1M-rule catalog: one createRule(QVariantMap) per rule vs importRules()
+    // from a file (parallel parse + one batch insert)
+    QFETCH(QString, mode);
+    constexpr int count = 1000000;
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("catalog." + mode);
+    if (mode != "createRule") {
+        QList<Rule> catalog;
+        catalog.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            catalog.append(Rule::fromVariantMap(sampleRule(i)));
+        }
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QVERIFY(RuleBulkIo::write(&file, catalog, RuleBulkIo::formatForPath(path)));
+    }
+
+    QElapsedTimer elapsed;
+    int imported = 0;
+    QBENCHMARK_ONCE {
+        RulesService rules;
+        elapsed.start();
+        if (mode == "createRule") {
+            for (int i = 0; i < count; ++i) {
+                rules.createRule(sampleRule(i));
+            }
+            imported = rules.getRuleCount();
+        } else {
+            imported = rules.importRules(path);
+        }
+        qInfo("%s: %d rules in %.0f ms", qPrintable(mode), imported, elapsed.nsecsElapsed() / 1e6);
+    }
+    QCOMPARE(imported, count);
+}
+
+void RulesBench::bulkExport_data()
+{
+    QTest::addColumn<QString>("mode");
+    QTest::newRow("variantList") << "variantList";
+    QTest::newRow("jsonl") << "jsonl";
+    QTest::newRow("csv") << "csv";
+}
+
+void RulesBench::bulkExport()
+{
+    // getAllRules() serialized as one JSON document vs streaming exportRules()
+    QFETCH(QString, mode);
+    RulesService* rules = service(1000000);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("catalog." + mode);
+    QBENCHMARK_ONCE {
+        if (mode == "variantList") {
+            QFile file(path);
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write(QJsonDocument::fromVariant(rules->getAllRules()).toJson(QJsonDocument::Compact));
+        } else {
+            QVERIFY(rules->exportRules(path));
+        }
+    }
+    qInfo("%s: %.1f MB", qPrintable(mode), QFileInfo(path).size() / 1e6);
+}
+
+void RulesBench::handoffReload()
+{
+    // Hot-reload handoff: stop() writes the store, the next instance reads
+    // it back and rebuilds programs, the id hash, time indexes and pool
+    QFETCH(int, size);
+    RulesService* rules = service(size);
+
+    QBuffer blob;
+    QVERIFY(blob.open(QIODevice::WriteOnly));
+    QElapsedTimer elapsed;
+    elapsed.start();
+    QVERIFY(rules->writeSnapshot(&blob));
+    const double writeMs = elapsed.nsecsElapsed() / 1e6;
+    blob.close();
+
+    double readMs = 0;
+    QBENCHMARK_ONCE {
+        RulesService adopted;
+        QVERIFY(blob.open(QIODevice::ReadOnly));
+        elapsed.start();
+        QVERIFY(adopted.readSnapshot(&blob));
+        readMs = elapsed.nsecsElapsed() / 1e6;
+        blob.close();
+        QCOMPARE(adopted.getRuleCount(), size);
+    }
+    qInfo("%d rules: write %.0f ms (%.1f MB), read and rebuild %.0f ms",
+          size, writeMs, blob.size() / 1e6, readMs);
+}
+
+void RulesBench::hedgedTail_data()
+{
+    QTest::addColumn<bool>("hedge");
+    QTest::newRow("plain") << false;
+    QTest::newRow("hedged") << true;
+}
+
+void RulesBench::hedgedTail()
+{
+    // OutboundHttp against a local server where 5% of responses take
+    // 150-300 ms instead of 2-10 ms: latency percentiles from submit to
+    // completion with a fixed number of requests outstanding
+    QFETCH(bool, hedge);
+    constexpr int requests = 2000;
+    constexpr int outstanding = 4;
+
+    DelayServer server(0.05);
+    QVERIFY(server.listen());
+    QNetworkAccessManager network;
+    network.setProxy(QNetworkProxy::NoProxy);
+    const QNetworkRequest request(server.url());
+    OutboundHttp http;
+
+    std::vector<qint64> latencies;
+    latencies.reserve(requests);
+    int submitted = 0;
+    int failed = 0;
+    std::function<void()> submitOne = [&]() {
+        if (submitted == requests) {
+            return;
+        }
+        ++submitted;
+        QElapsedTimer timer;
+        timer.start();
+        http.submit([&network, &request]() { return network.get(request); },
+                    [&, timer](QNetworkReply* reply) {
+                        latencies.push_back(timer.elapsed());
+                        failed += reply->error() != QNetworkReply::NoError;
+                        submitOne();
+                    },
+                    hedge);
+    };
+
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < outstanding; ++i) {
+            submitOne();
+        }
+        QTRY_VERIFY_WITH_TIMEOUT(latencies.size() == size_t(requests), 120000);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+    };
+    const QVariantMap stats = http.stats();
+    qInfo("%s: p50 %lld ms, p99 %lld ms, max %lld ms; hedges sent %llu, won %llu; limit %d, %d failed",
+          hedge ? "hedged" : "plain", percentile(0.50), percentile(0.99), latencies.back(),
+          stats.value("hedgesSent").toULongLong(), stats.value("hedgesWon").toULongLong(),
+          stats.value("limit").toInt(), failed);
+    QCOMPARE(failed, 0);
+}
+
+void RulesBench::allocationChurn()
+{
+    // Heap traffic of loading 1M rules and of a sustained replay through
+    // the sharded checker; run on the previous build for the baseline
+    const AllocationCounter counting;
+    RulesService rules;
+    reportMemory("before load");
+
+    quint64 before = allocationCount();
+    for (int i = 0; i < 1000000; ++i) {
+        rules.createRule(sampleRule(i));
+    }
+    qInfo("load: %.2f allocations per rule", (allocationCount() - before) / 1e6);
+    reportMemory("after load");
+
+    for (int i = 0; i < 100; ++i) {
+        QVariantMap data = sampleRule(i);
+        data["status"] = "active";
+        data["condition"] = QString(R"(totalAmount > %1 && customer.tier != "gold")").arg(i * 100);
+        rules.createRule(data);
+    }
+    QTRY_COMPARE(rules.compiledRules().version(), quint64(100));
+
+    WorkStealingPool pool;
+    ShardedChecker checker(rules, pool, {}, pool.threadCount() * 8, nullptr);
+
+    constexpr int events = 200000;
+    std::vector<CheckRequest> requests(events);
+    for (int i = 0; i < events; ++i) {
+        CheckRequest& request = requests[static_cast<size_t>(i)];
+        request.orderId = QString::number(i);
+        request.customer = QString("Customer %1").arg(i % 5000);
+        request.data = {{"totalAmount", (i % 2000) * 5.0},
+                        {"customer", QVariantMap{{"tier", i % 3 ? "silver" : "gold"}}}};
+    }
+
+    QElapsedTimer elapsed;
+    qint64 elapsedNs = 0;
+    quint64 allocations = 0;
+    int rounds = 0;
+    QBENCHMARK {
+        before = allocationCount();
+        elapsed.start();
+        for (const CheckRequest& request : requests) {
+            checker.submit(CheckRequest(request));
+        }
+        checker.waitForIdle();
+        elapsedNs += elapsed.nsecsElapsed();
+        allocations += allocationCount() - before;
+        ++rounds;
+    }
+    qInfo("replay: %.0f k events/s, %.2f allocations per event",
+          double(events) * rounds / (elapsedNs / 1e9) / 1e3, double(allocations) / (double(events) * rounds));
+    reportMemory("after replay");
+}
+
+QTEST_GUILESS_MAIN(RulesBench)
+
+#include "rules_bench.moc"
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "timing_wheel.h"
+
+#include <QHash>
+#include <QString>
+#include <vector>
+
+namespace rules {
+
+/**
+ * @brief String keys mapped to dense slots, with LRU eviction and idle expiry
+ *
+ * The bookkeeping shared by WindowAggregator and CorrelationStore: owners
+ * keep their per-key data in arrays indexed by slot and let this class
+ * decide which slot a key lives in and when it goes. Lookups are a single
+ * hash probe; beyond maxKeys use() recycles the least recently used slot,
+ * and advance() releases keys not used for idleMs through a TimingWheel.
+ *
+ * Each slot has at most one pending timer, which outlives the key that
+ * armed it: a released or recycled slot keeps its timer, and a key given
+ * that slot re-arms from it when it fires. The wheel therefore never holds
+ * more timers than there are slots (at most maxKeys), however fast keys
+ * are evicted.
+ */
+class BoundedLru
+{
+public:
+    static constexpr quint32 NONE = 0xFFFFFFFFu;
+
+    BoundedLru(qint64 idleMs, size_t maxKeys, qint64 startMs, qint64 tickMs);
+
+    // NONE if unknown
+    quint32 find(const QString& key) const;
+
+    // Slot of key, now the most recently used, last seen at nowMs (the
+    // later time wins). *created is set when the key was not present: the
+    // slot is fresh or recycled and the owner must reset its data.
+    quint32 use(const QString& key, qint64 nowMs, bool* created = nullptr);
+    void touch(quint32 slot, qint64 nowMs);
+
+    // The released slot, or NONE if unknown
+    quint32 remove(const QString& key);
+
+    // Releases keys idle for idleMs and returns their slots; call at least
+    // once per tick
+    std::vector<quint32> advance(qint64 nowMs);
+
+    bool expired(quint32 slot, qint64 nowMs) const { return nowMs - m_slots[slot].lastSeenMs >= m_idleMs; }
+    qint64 idleMs() const { return m_idleMs; }
+
+    size_t size() const { return static_cast<size_t>(m_index.size()); }
+    size_t maxKeys() const { return m_maxKeys; }
+    size_t slotCount() const { return m_slots.size(); }    // owners size their arrays to this
+    quint64 evictedCount() const { return m_evicted; }
+    quint64 expiredCount() const { return m_expired; }
+    size_t memoryBytes() const;     // excludes the key strings' character data
+
+private:
+    struct Slot {
+        QString key;
+        qint64 lastSeenMs = 0;
+        bool used = false;
+        bool armed = false;     // a timer for this slot is pending
+        quint32 prev = NONE;    // LRU list, head = most recently used
+        quint32 next = NONE;
+    };
+
+    void release(quint32 slot);
+    void linkFront(quint32 slot);
+    void unlink(quint32 slot);
+    void moveToFront(quint32 slot);
+    void scheduleExpiry(quint32 slot);
+
+    qint64 m_idleMs;
+    size_t m_maxKeys;
+
+    QHash<QString, quint32> m_index;
+    std::vector<Slot> m_slots;
+    std::vector<quint32> m_freeSlots;
+    quint32 m_head = NONE;
+    quint32 m_tail = NONE;
+
+    TimingWheel m_wheel;
+    quint64 m_evicted = 0;
+    quint64 m_expired = 0;
+};
+
+} // namespace rules
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "bounded_lru.h"
+
+#include <QString>
+#include <vector>
+
+namespace rules {
+
+/**
+ * @brief What later order events need to know about orders/created
+ *
+ * Strings share the EventBus payload's data (implicit sharing), so a
+ * projection costs a few words plus whatever the bus already allocated.
+ */
+struct OrderProjection {
+    QString customerName;
+    QString status;
+    double totalAmount = 0;
+    qint64 createdAtMs = 0;
+};
+
+/**
+ * @brief orderId -> OrderProjection join table with TTL and a size cap
+ *
+ * Lookups are a single hash probe. Entries expire ttlMs after their last
+ * put()/touch() (released by advance(), and never returned once due);
+ * beyond maxEntries the least recently touched order is evicted.
+ */
+class CorrelationStore
+{
+public:
+    CorrelationStore(qint64 ttlMs, size_t maxEntries, qint64 startMs, qint64 tickMs = 1000);
+
+    void put(const QString& orderId, const OrderProjection& projection, qint64 nowMs);
+
+    // nullptr if unknown or expired at nowMs; the pointer is valid until
+    // the next mutation
+    const OrderProjection* find(const QString& orderId, qint64 nowMs) const;
+
+    // Like find(), but refreshes the entry's TTL and LRU position
+    OrderProjection* touch(const QString& orderId, qint64 nowMs);
+
+    bool remove(const QString& orderId);
+    void advance(qint64 nowMs);
+
+    size_t size() const { return m_keys.size(); }
+    quint64 evictedCount() const { return m_keys.evictedCount(); }
+    quint64 expiredCount() const { return m_keys.expiredCount(); }
+    size_t memoryBytes() const;
+
+private:
+    BoundedLru m_keys;
+    std::vector<OrderProjection> m_projections;     // by BoundedLru slot
+};
+
+} // namespace rules
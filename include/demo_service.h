@@ -1,25 +1,37 @@
 #pragma once
 
 #include <QObject>
+#include <QAbstractItemModel>
 #include <QVariantList>
 #include <QElapsedTimer>
 #include <memory>
 
+class QNetworkAccessManager;
+class QNetworkReply;
+
 namespace mpf::http { class HttpClient; }
 
 namespace rules {
 
+class OutboundHttp;
+class EventRecorder;
+class EventMessageModel;
+
 /**
  * @brief Demo service for showcasing HTTP client and EventBus capabilities
  *
  * Provides Q_INVOKABLE methods for QML to:
  * - Send HTTP GET/POST requests via mpf::http::HttpClient
+ * - Encode request and decode response bodies off the GUI thread (PayloadCodec)
+ * - Limit concurrency and hedge slow GETs (OutboundHttp)
  * - Accumulate received EventBus messages for display
+ * - Record received EventBus traffic for offline replay (EventRecorder)
  */
 class DemoService : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(QVariantList receivedMessages READ receivedMessages NOTIFY messagesChanged)
+    Q_PROPERTY(QAbstractItemModel* messageModel READ messageModel CONSTANT)
 
 public:
     explicit DemoService(const QString& pluginId, QObject* parent = nullptr);
@@ -28,27 +40,47 @@ public:
     // HTTP demo
     Q_INVOKABLE void testGet(const QString& url);
     Q_INVOKABLE void testPost(const QString& url, const QString& jsonBody);
+    Q_INVOKABLE void testPostCbor(const QString& url, const QString& jsonBody);
+    Q_INVOKABLE QVariantMap httpStats() const;
 
-    // EventBus message accumulation
+    // EventBus message accumulation. messageModel is the cheap view for
+    // QML; receivedMessages converts every stored record on each read.
     QVariantList receivedMessages() const;
+    QAbstractItemModel* messageModel() const;
     Q_INVOKABLE void clearMessages();
     Q_INVOKABLE int messageCount() const;
 
-    // Connect to EventBus signal for persistent listening
+    // Traffic recording (see tools/rules_replay.cpp)
+    Q_INVOKABLE bool startRecording(const QString& path);
+    Q_INVOKABLE void stopRecording();
+
+    // Subscribes to topicPrefix**; delivery goes through EventScheduler
     void connectToEventBus(QObject* eventBusObj, const QString& topicPrefix);
+    void setTopicPrefix(const QString& topicPrefix) { m_topicPrefix = topicPrefix; }
 
 signals:
     void httpResponseReceived(bool success, int statusCode,
                               const QString& body, int elapsedMs);
+    // Emitted after httpResponseReceived when the body parsed as JSON/CBOR
+    void httpResponseParsed(int statusCode, const QVariant& data, int elapsedMs);
     void messagesChanged();
 
 public slots:
     void onEventReceived(const QString& topic, const QVariantMap& data,
                          const QString& senderId);
+    // Writes the event to the active recording, if any. Connected to
+    // EventScheduler::eventArrived so recordings include shed events.
+    void recordEvent(const QString& topic, const QVariantMap& data,
+                     const QString& senderId);
 
 private:
+    void handleReply(QNetworkReply* reply);
+
     std::unique_ptr<mpf::http::HttpClient> m_httpClient;
-    QVariantList m_receivedMessages;
+    std::unique_ptr<OutboundHttp> m_outbound;
+    std::unique_ptr<EventRecorder> m_recorder;
+    QNetworkAccessManager* m_rawNetwork = nullptr;  // raw-body (CBOR) posts, created on demand
+    EventMessageModel* m_messages = nullptr;
     QString m_pluginId;
     QString m_topicPrefix;
     QElapsedTimer m_requestTimer;
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QtGlobal>
+#include <cstddef>
+
+namespace rules::epoch {
+
+/**
+ * @brief Epoch-based reclamation for read-mostly shared objects
+ *
+ * Readers pin the global epoch with a Guard (two atomic stores, no
+ * locks) and may use any object they load while the guard lives.
+ * Writers unpublish an object, then retire() it; it is destroyed by a
+ * later collect() once every thread that was pinned at retirement has
+ * unpinned. Guards nest; each thread that ever reads takes one of
+ * MAX_THREADS slots for its lifetime. Threads beyond that pin through a
+ * mutex-protected overflow list instead: correct, just slower.
+ */
+constexpr int MAX_THREADS = 512;
+
+class Guard
+{
+public:
+    Guard();
+    ~Guard();
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+};
+
+void retire(void* object, void (*destroy)(void*));
+
+template <typename T>
+void retire(const T* object)
+{
+    retire(const_cast<T*>(object), [](void* p) { delete static_cast<T*>(p); });
+}
+
+// Destroys retired objects no reader can still see; returns how many
+size_t collect();
+size_t pendingCount();
+
+} // namespace rules::epoch
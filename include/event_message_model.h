@@ -0,0 +1,81 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QStringList>
+#include <QVariantMap>
+#include <vector>
+
+namespace rules {
+
+/**
+ * @brief Compact record of one received EventBus event
+ *
+ * Topic and sender are indexes into the owning model's string table, the
+ * timestamp is raw epoch milliseconds and the payload is the bus's own
+ * (implicitly shared) map, so storing an event allocates nothing per field.
+ */
+struct EventRecord {
+    quint16 topic = 0;
+    quint16 sender = 0;
+    qint64 epochMs = 0;
+    QVariantMap payload;
+};
+
+/**
+ * @brief Newest-first ring buffer of EventRecords exposed to QML
+ *
+ * Conversion to QML values (including timestamp formatting) happens in
+ * data(), i.e. only for rows a view actually displays.
+ */
+class EventMessageModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+public:
+    enum Roles {
+        TopicRole = Qt::UserRole + 1,
+        SenderIdRole,
+        TimestampRole,
+        MessageRole,
+        DataRole
+    };
+
+    explicit EventMessageModel(int capacity, QObject* parent = nullptr);
+    ~EventMessageModel() override;
+
+    // Returns true if the oldest record was evicted to make room
+    bool append(const QString& topic, const QString& senderId, qint64 epochMs,
+                const QVariantMap& payload);
+    void clear();
+
+    // Full QVariantMap conversion, for callers that need a plain list
+    QVariantList toVariantList() const;
+
+    // QAbstractListModel interface
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void countChanged();
+
+private:
+    size_t slotAt(int row) const;                // row 0 = newest
+    const EventRecord& recordAt(int row) const;
+    quint16 intern(const QString& value);
+    void compactStrings();
+
+    std::vector<EventRecord> m_ring;
+    int m_head = 0;      // slot the next record goes to
+    int m_count = 0;
+
+    QHash<QString, quint16> m_stringIds;
+    QStringList m_strings;
+
+    // Interned strings are reclaimed by re-interning the live records
+    static constexpr int MAX_STRINGS = 1024;
+};
+
+} // namespace rules
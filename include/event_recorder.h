@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QStringList>
+#include <QVariantMap>
+
+namespace rules {
+
+struct RecordedEvent {
+    qint64 offsetNs = 0;    // since the recording started
+    QString topic;
+    QVariantMap data;
+    QString senderId;
+};
+
+/**
+ * @brief Binary log of EventBus traffic
+ *
+ * Layout: magic, version, then a stream of records. Topics and sender ids
+ * are interned: the first occurrence writes a definition record, later
+ * events refer to it by a 16-bit index. Event records carry the offset
+ * from the start of the recording in nanoseconds and the payload as a
+ * QDataStream-serialized QVariantMap.
+ */
+class EventRecorder
+{
+public:
+    explicit EventRecorder(const QString& path);
+    ~EventRecorder();
+
+    bool isOpen() const { return m_file.isOpen(); }
+    QString path() const { return m_file.fileName(); }
+    quint64 eventCount() const { return m_eventCount; }
+
+    void record(const QString& topic, const QVariantMap& data, const QString& senderId);
+    void flush();
+
+private:
+    quint16 intern(const QString& value);
+
+    QFile m_file;
+    QDataStream m_out;
+    QElapsedTimer m_clock;
+    QHash<QString, quint16> m_strings;
+    quint64 m_eventCount = 0;
+};
+
+class EventLogReader
+{
+public:
+    explicit EventLogReader(const QString& path);
+
+    bool isOpen() const { return m_valid; }
+    bool next(RecordedEvent& event);
+
+private:
+    QFile m_file;
+    QDataStream m_in;
+    QStringList m_strings;
+    bool m_valid = false;
+};
+
+} // namespace rules
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QVariantMap>
+#include <deque>
+#include <vector>
+
+namespace mpf { class IEventBus; }
+
+namespace rules {
+
+/**
+ * @brief What a full priority class does with one more event
+ */
+enum class ShedPolicy {
+    DropOldest,         // evict the class's oldest queued event
+    DropLowestPriority, // evict the oldest event of the lowest-priority class
+                        // queued below this one, else drop the new event
+    Sample              // past half capacity admit 1 in sampleEvery; drop when full
+};
+
+struct PriorityClass {
+    QString name;
+    QStringList topics;         // exact topics, or prefixes ending in '/'
+    int priority = 0;           // lower is dispatched first
+    int capacity = 1000;
+    qint64 deadlineMs = 0;      // queued longer is shed at dispatch; 0 = never
+    ShedPolicy policy = ShedPolicy::DropOldest;
+    int sampleEvery = 10;
+};
+
+/**
+ * @brief Priority queues between the EventBus and the plugin's handlers
+ *
+ * The bus delivers synchronously, so a flooding publisher used to make
+ * every handler run in arrival order inside its publish() calls. Events
+ * are now classified by topic into bounded per-class queues and
+ * dispatched from the event loop, highest priority first, in slices of
+ * at most sliceMs so the GUI keeps up. Full queues shed according to
+ * their class policy; events past their deadline are shed on dispatch.
+ * Topics matching no class are ignored.
+ *
+ * Backpressure: when the queues pass 80% of their combined capacity,
+ * {active: true, queued, capacity, shed} is published on
+ * rules/backpressure, and {active: false, ...} once they drain below 50%.
+ */
+class EventScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EventScheduler(const QString& pluginId, QObject* parent = nullptr);
+    ~EventScheduler() override;
+
+    void addClass(const PriorityClass& spec);
+
+    // Admits the bus's events and publishes backpressure on it
+    void connectToEventBus(mpf::IEventBus* eventBus);
+
+    void setSliceMs(int sliceMs) { m_sliceMs = sliceMs; }
+
+    int queued() const { return m_queued; }
+    int capacity() const { return m_capacity; }
+
+    // {class name: {queued, admitted, dispatched, shed, expired}}
+    QVariantMap stats() const;
+
+signals:
+    // Every submitted event, before classification and shedding
+    void eventArrived(const QString& topic, const QVariantMap& data,
+                      const QString& senderId);
+    void eventDispatched(const QString& topic, const QVariantMap& data,
+                         const QString& senderId);
+
+public slots:
+    // false if the event was shed or matches no class
+    bool submit(const QString& topic, const QVariantMap& data,
+                const QString& senderId);
+
+private slots:
+    void dispatch();
+
+private:
+    struct Event {
+        QString topic;
+        QVariantMap data;
+        QString senderId;
+        qint64 enqueuedNs = 0;
+    };
+
+    struct Queue {
+        PriorityClass spec;
+        std::deque<Event> events;
+        quint64 arrivals = 0;       // for sampling
+        quint64 admitted = 0;
+        quint64 dispatched = 0;
+        quint64 shed = 0;
+        quint64 expired = 0;
+    };
+
+    Queue* classify(const QString& topic);
+    bool makeRoom(Queue& queue);
+    void shedOldest(Queue& queue);
+    void updateBackpressure();
+
+    QString m_pluginId;
+    mpf::IEventBus* m_eventBus = nullptr;
+    std::vector<Queue> m_queues;        // by priority
+    QElapsedTimer m_clock;
+    int m_queued = 0;
+    int m_capacity = 0;
+    int m_sliceMs = 5;
+    bool m_dispatchPending = false;
+    bool m_backpressure = false;
+};
+
+} // namespace rules
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "rules_service.h"
+
+#include <QList>
+#include <QString>
+#include <QStringView>
+#include <QtPlugin>
+#include <limits>
+#include <vector>
+
+namespace rules {
+
+/**
+ * @brief Typed order input for IRulesService::evaluate()
+ *
+ * Views only: the caller keeps the strings alive for the call. Fields
+ * map to condition paths of the same name; conditions reading any other
+ * path see null.
+ */
+struct OrderRecord {
+    QStringView orderId;
+    QStringView customerName;
+    QStringView status;
+    double totalAmount = 0;
+    int quantity = 0;
+    double price = 0;
+};
+
+/**
+ * @brief Outcome of one record: matches[first .. first + count)
+ */
+struct EvaluationResult {
+    quint32 first = 0;
+    quint32 count = 0;
+    bool passed() const { return count == 0; }
+};
+
+/**
+ * @brief O(1) reference to a rule, valid until the next rule mutation
+ */
+struct RuleHandle {
+    quint32 index = std::numeric_limits<quint32>::max();
+    quint64 generation = 0;
+    bool isValid() const { return index != std::numeric_limits<quint32>::max(); }
+};
+
+/**
+ * @brief Immutable view of the rule store at one generation
+ *
+ * Shares storage with RulesService (implicitly shared QList), so taking
+ * one is O(1); the service copies on its next mutation instead.
+ */
+class RulesSnapshot
+{
+public:
+    RulesSnapshot() = default;
+    RulesSnapshot(quint64 generation, QList<Rule> rules)
+        : m_generation(generation), m_rules(std::move(rules)) {}
+
+    quint64 generation() const { return m_generation; }
+    qsizetype size() const { return m_rules.size(); }
+    const Rule& at(qsizetype i) const { return m_rules.at(i); }
+    QList<Rule>::const_iterator begin() const { return m_rules.cbegin(); }
+    QList<Rule>::const_iterator end() const { return m_rules.cend(); }
+
+    // nullptr if the handle belongs to another generation
+    const Rule* rule(RuleHandle handle) const
+    {
+        return handle.generation == m_generation && handle.index < quint32(m_rules.size())
+            ? &m_rules.at(handle.index) : nullptr;
+    }
+
+private:
+    quint64 m_generation = 0;
+    QList<Rule> m_rules;
+};
+
+/**
+ * @brief Cross-plugin C++ interface to the rules plugin
+ *
+ * Registered in the ServiceRegistry by RulesPlugin::initialize():
+ *
+ *   auto* rules = registry->get<rules::IRulesService>();
+ *   std::vector<QString> matches;
+ *   rules->evaluate(orders.data(), orders.size(), results.data(), matches);
+ *
+ * evaluate() is safe from any thread. Record strings are read in place
+ * and the field buffer is reused per thread, so apart from conditions
+ * that concatenate strings it allocates only to grow `matches`; the
+ * other calls belong on the GUI thread. The first call
+ * activates the plugin's services if nothing else has yet. The interface
+ * is unregistered when the plugin stops, after evaluate() calls already
+ * running have returned; a pointer kept past that sees no rules
+ * (evaluate() matches nothing and returns version 0).
+ */
+class IRulesService
+{
+public:
+    static constexpr int apiVersion = 1;
+
+    virtual ~IRulesService() = default;
+
+    // Checks orders[0 .. count) against the active rule conditions.
+    // results[i] indexes the ids of the rules order i matched, appended to
+    // `matches`. Returns the CompiledRuleSet version used for all records.
+    virtual quint64 evaluate(const OrderRecord* orders, qsizetype count,
+                             EvaluationResult* results, std::vector<QString>& matches) const = 0;
+
+    virtual RuleHandle find(const QString& id) const = 0;
+    virtual const Rule* rule(RuleHandle handle) const = 0;   // nullptr when stale
+    virtual RulesSnapshot snapshot() const = 0;
+};
+
+} // namespace rules
+
+#define RULES_IRulesService_iid "com.biiz.rules.IRulesService/1.0"
+Q_DECLARE_INTERFACE(rules::IRulesService, RULES_IRulesService_iid)
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QVariantMap>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class QNetworkReply;
+
+namespace rules {
+
+/**
+ * @brief Rolling window of request latencies with percentile queries
+ */
+class LatencyTracker
+{
+public:
+    explicit LatencyTracker(int capacity = 256);
+
+    void add(qint64 latencyMs);
+    qint64 percentile(double p) const;   // p in [0, 1]; -1 if no samples
+    int sampleCount() const { return m_count; }
+
+private:
+    std::vector<qint64> m_samples;
+    int m_next = 0;
+    int m_count = 0;
+};
+
+/**
+ * @brief AIMD concurrency limit driven by observed latency
+ *
+ * The limit grows by 1/limit per fast completion and shrinks by a constant
+ * factor when a request fails or takes more than LATENCY_TOLERANCE times
+ * the no-load baseline. The baseline follows new minimums immediately and
+ * drifts up slowly so it can recover after a backend gets slower for good.
+ */
+class ConcurrencyLimiter
+{
+public:
+    enum class Outcome {
+        Success,
+        Dropped,    // error or timeout
+        Ignored     // cancelled (e.g. hedge loser); frees the slot only
+    };
+
+    explicit ConcurrencyLimiter(int initialLimit = 8, int minLimit = 1, int maxLimit = 64);
+
+    bool tryAcquire();
+    void release(qint64 latencyMs, Outcome outcome);
+
+    int limit() const { return static_cast<int>(m_limit); }
+    int inFlight() const { return m_inFlight; }
+
+    static constexpr double LATENCY_TOLERANCE = 2.0;
+    static constexpr double BACKOFF_FACTOR = 0.9;
+
+private:
+    double m_limit;
+    int m_minLimit;
+    int m_maxLimit;
+    int m_inFlight = 0;
+    double m_baselineMs = -1;
+};
+
+/**
+ * @brief Outbound HTTP request scheduling with hedging and concurrency control
+ *
+ * Every request goes through a ConcurrencyLimiter; requests beyond the
+ * current limit wait in a FIFO queue. Hedged requests send a second attempt
+ * when the first has not finished within the observed p95 latency; the
+ * first attempt to finish wins and the other is aborted. Only idempotent
+ * requests (GET) should be hedged.
+ */
+class OutboundHttp : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Sender = std::function<QNetworkReply*()>;
+    using Callback = std::function<void(QNetworkReply*)>;
+
+    explicit OutboundHttp(QObject* parent = nullptr);
+    ~OutboundHttp() override;
+
+    // `send` may be called twice when hedging; `done` receives the winning
+    // reply once, after it finished. The reply is deleted afterwards.
+    void submit(Sender send, Callback done, bool hedge);
+
+    int inFlight() const { return m_limiter.inFlight(); }
+    int queued() const { return static_cast<int>(m_queue.size()); }
+    QVariantMap stats() const;
+
+    static constexpr int MIN_SAMPLES_FOR_HEDGE = 20;
+    static constexpr int MIN_HEDGE_DELAY_MS = 10;
+
+signals:
+    void inFlightChanged(int inFlight);
+
+private:
+    struct Request {
+        Sender send;
+        Callback done;
+        bool hedge = false;
+        bool completed = false;
+        QElapsedTimer timer;
+        QList<QNetworkReply*> attempts;
+    };
+
+    void dispatch();
+    void start(const std::shared_ptr<Request>& request);
+    void launch(const std::shared_ptr<Request>& request, bool isHedge);
+    int hedgeDelayMs() const;
+
+    ConcurrencyLimiter m_limiter;
+    LatencyTracker m_latency;
+    std::deque<std::shared_ptr<Request>> m_queue;
+    quint64 m_hedgesSent = 0;
+    quint64 m_hedgesWon = 0;
+};
+
+} // namespace rules
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFuture>
+#include <QJsonObject>
+#include <QString>
+#include <QVariant>
+
+namespace rules {
+
+enum class PayloadFormat {
+    Json,
+    Cbor
+};
+
+struct EncodedPayload {
+    bool ok = false;
+    QString error;
+    QJsonObject json;       // Json: validated document root, ready for postJson()
+    QByteArray bytes;       // Cbor: serialized request body
+};
+
+struct DecodedPayload {
+    bool ok = false;        // body was parsed as JSON/CBOR
+    QVariant value;         // parsed document (QVariantMap / QVariantList)
+    QString text;           // display text, capped at MAX_DISPLAY_BYTES
+    qsizetype size = 0;     // raw body size in bytes
+};
+
+/**
+ * @brief Worker-thread JSON/CBOR encoding and decoding for HTTP payloads
+ *
+ * encode()/decode() run on QThreadPool::globalInstance() and return a
+ * QFuture; attach a continuation with QFuture::then(context, ...) to get
+ * the result back on the caller's thread. The GUI thread only pays for
+ * handing over the (implicitly shared) input buffer.
+ */
+class PayloadCodec
+{
+public:
+    static QFuture<EncodedPayload> encode(const QString& jsonText, PayloadFormat format);
+    static QFuture<DecodedPayload> decode(const QByteArray& body, const QString& contentType);
+
+    // Synchronous variants, used by the async ones and by benchmarks
+    static EncodedPayload encodeNow(const QString& jsonText, PayloadFormat format);
+    static DecodedPayload decodeNow(const QByteArray& body, const QString& contentType);
+
+    static QString contentType(PayloadFormat format);
+
+    // Larger bodies are still parsed in full, but only this much is shown
+    static constexpr qsizetype MAX_DISPLAY_BYTES = 64 * 1024;
+};
+
+} // namespace rules
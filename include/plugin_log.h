@@ -0,0 +1,121 @@
+#pragma once
+
+#include <QVariant>
+#include <array>
+#include <atomic>
+#include <utility>
+
+namespace rules::log {
+
+/**
+ * @brief Level-gated, asynchronous logging for the rules plugin
+ *
+ * The RULES_LOG_* macros check the level before evaluating their
+ * arguments. Enabled records carry the format string and up to MAX_ARGS
+ * QVariant arguments (QStrings are shared, not copied) through a bounded
+ * lock-free queue; a background sink formats them with QString::arg()
+ * and hands them to the MPF logger. The level comes from
+ * MPF_RULES_LOG_LEVEL (debug, info, warning, error, off; default info).
+ * Records that find the queue full are dropped and counted in
+ * MetricCounters::logRecordsDropped.
+ */
+enum class Level : int {
+    Debug = 0,
+    Info,
+    Warning,
+    Error,
+    Off
+};
+
+constexpr int MAX_ARGS = 4;
+
+struct Record {
+    Level level = Level::Info;
+    const char* tag = nullptr;      // string literal
+    const char* format = nullptr;   // string literal, %1..%4 placeholders
+    std::array<QVariant, MAX_ARGS> args;
+    int argc = 0;
+};
+
+extern std::atomic<int> g_level;
+
+inline bool enabled(Level level)
+{
+    return static_cast<int>(level) >= g_level.load(std::memory_order_relaxed);
+}
+
+void setLevel(Level level);
+Level level();
+
+void enqueue(Record&& record);
+
+// Drains everything queued so far (used on stop() and by benchmarks)
+void flush();
+
+// shutdown() drains and joins the sink thread; until the next open(),
+// records are formatted on the caller's thread and no thread is started
+void open();
+void shutdown();
+
+template <typename... Args>
+void write(Level level, const char* tag, const char* format, Args&&... args)
+{
+    static_assert(sizeof...(Args) <= MAX_ARGS, "too many log arguments");
+
+    Record record;
+    record.level = level;
+    record.tag = tag;
+    record.format = format;
+    record.argc = static_cast<int>(sizeof...(Args));
+    int i = 0;
+    ((record.args[static_cast<size_t>(i++)] = QVariant::fromValue(std::forward<Args>(args))), ...);
+    enqueue(std::move(record));
+}
+
+/**
+ * @brief Fixed one-second window limiter for per-event log call sites
+ */
+class RateLimiter
+{
+public:
+    explicit RateLimiter(int perSecond) : m_perSecond(perSecond) {}
+
+    bool allow();
+    quint64 takeSuppressed() { return m_suppressed.exchange(0, std::memory_order_relaxed); }
+
+private:
+    const int m_perSecond;
+    std::atomic<qint64> m_window{-1};
+    std::atomic<int> m_count{0};
+    std::atomic<quint64> m_suppressed{0};
+};
+
+} // namespace rules::log
+
+#define RULES_LOG(level, tag, ...)                                      \
+    do {                                                                \
+        if (::rules::log::enabled(level)) {                             \
+            ::rules::log::write(level, tag, __VA_ARGS__);               \
+        }                                                               \
+    } while (0)
+
+#define RULES_LOG_DEBUG(tag, ...) RULES_LOG(::rules::log::Level::Debug, tag, __VA_ARGS__)
+#define RULES_LOG_INFO(tag, ...) RULES_LOG(::rules::log::Level::Info, tag, __VA_ARGS__)
+#define RULES_LOG_WARNING(tag, ...) RULES_LOG(::rules::log::Level::Warning, tag, __VA_ARGS__)
+#define RULES_LOG_ERROR(tag, ...) RULES_LOG(::rules::log::Level::Error, tag, __VA_ARGS__)
+
+// At most perSecond records per second from this call site; the number of
+// suppressed records is reported with the next one that gets through
+#define RULES_LOG_RATE_LIMITED(level, perSecond, tag, ...)                          \
+    do {                                                                            \
+        if (::rules::log::enabled(level)) {                                         \
+            static ::rules::log::RateLimiter rulesLogLimiter_(perSecond);           \
+            if (rulesLogLimiter_.allow()) {                                         \
+                if (quint64 suppressed_ = rulesLogLimiter_.takeSuppressed()) {      \
+                    ::rules::log::write(level, tag, "(%1 similar messages suppressed)", \
+                                        suppressed_);                               \
+                }                                                                   \
+                ::rules::log::write(level, tag, __VA_ARGS__);                       \
+            }                                                                       \
+        }                                                                           \
+    } while (0)
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "rule_expression.h"
+
+#include <QHash>
+#include <vector>
+
+namespace rules {
+
+/**
+ * @brief Memoized rule-set results keyed by the field values the set reads
+ *
+ * An entry maps (rule-set version, values of the set's fieldSlots) to the
+ * indices of the rules that matched. Lookups compare the stored values,
+ * so a hash collision is a miss, never a wrong result. A lookup with a
+ * newer version drops every entry, so rule edits invalidate the cache
+ * without the service having to know about it. Eviction is CLOCK: a hit
+ * sets the entry's reference bit, the hand clears bits until it finds an
+ * unreferenced victim.
+ *
+ * Not thread-safe; ShardedChecker keeps one per shard.
+ */
+class ResultCache
+{
+public:
+    explicit ResultCache(size_t capacity);
+
+    static size_t hashFields(quint64 version, const std::vector<int>& fieldSlots,
+                             const expr::Value* fields);
+
+    // Matched rule indices, or nullptr; valid until the next insert()
+    const std::vector<int>* find(quint64 version, const std::vector<int>& fieldSlots,
+                                 const expr::Value* fields, size_t hash);
+    // Copies key and matches into the victim entry's vectors, which keep
+    // their capacity, so a warm cache inserts without allocating
+    void insert(quint64 version, const std::vector<int>& fieldSlots,
+                const expr::Value* fields, size_t hash, const std::vector<int>& matched);
+
+    size_t size() const { return static_cast<size_t>(m_index.size()); }
+    size_t capacity() const { return m_entries.size(); }
+
+private:
+    struct Entry {
+        size_t hash = 0;
+        std::vector<expr::Value> key;   // values of the set's fieldSlots
+        std::vector<int> matched;
+        bool used = false;
+        bool referenced = false;
+    };
+
+    void reset(quint64 version);
+
+    std::vector<Entry> m_entries;
+    QHash<size_t, int> m_index;         // hash -> entry
+    size_t m_hand = 0;
+    quint64 m_version = 0;
+};
+
+} // namespace rules
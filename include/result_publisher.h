@@ -0,0 +1,72 @@
+#pragma once
+
+#include "sharded_checker.h"
+
+#include <QObject>
+#include <QTimer>
+#include <QVariantMap>
+#include <mutex>
+#include <vector>
+
+namespace mpf { class IEventBus; }
+
+namespace rules {
+
+/**
+ * @brief Publishes check results in batches on rules/check/batch
+ *
+ * add() only appends to a buffer (from any thread); the buffer is
+ * published as one event when it holds maxResults results or maxDelayMs
+ * after its first result, whichever comes first. One publish and one
+ * QVariantMap per batch instead of per order.
+ *
+ * The payload is columnar:
+ *   count          int
+ *   orderIds       QStringList
+ *   passed         QByteArray, one 0/1 byte per order
+ *   checkedAt      QList<qint64>
+ *   ruleIds        QStringList, the distinct matched rules of the batch
+ *   ruleNames      QStringList, parallel to ruleIds
+ *   matchOffsets   QList<int>, count + 1 entries; order i matched
+ *   matches        QList<int>  ruleIds[matches[matchOffsets[i] .. matchOffsets[i + 1]]]
+ *
+ * split() turns a batch back into per-order {orderId, passed,
+ * matchedRules, reason, checkedAt} maps. With setSplitting(true)
+ * (MPF_RULES_SPLIT_RESULTS=1) each of those is also published on
+ * rules/check/completed for consumers that expect one event per order.
+ */
+class ResultPublisher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ResultPublisher(const QString& pluginId, QObject* parent = nullptr);
+    ~ResultPublisher() override;
+
+    void setEventBus(mpf::IEventBus* eventBus) { m_eventBus = eventBus; }
+    void setBatchLimits(int maxResults, int maxDelayMs);
+    void setSplitting(bool splitting) { m_splitting = splitting; }
+
+    // Thread-safe; per-thread order is kept within and across batches
+    void add(const CheckResult& result);
+
+    static QVariantMap encode(const std::vector<CheckResult>& results);
+    static QList<QVariantMap> split(const QVariantMap& batch);
+
+public slots:
+    void flush();
+
+private:
+    QString m_pluginId;
+    mpf::IEventBus* m_eventBus = nullptr;
+    QTimer m_delayTimer;
+    int m_maxResults = 256;
+    int m_maxDelayMs = 20;
+    bool m_splitting = false;
+
+    std::mutex m_mutex;
+    std::vector<CheckResult> m_pending;
+    bool m_flushQueued = false;
+};
+
+} // namespace rules
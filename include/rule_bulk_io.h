@@ -0,0 +1,52 @@
+#pragma once
+
+#include "rules_service.h"
+
+#include <QByteArrayView>
+#include <QList>
+#include <QString>
+
+class QIODevice;
+
+namespace rules {
+
+enum class BulkFormat {
+    JsonLines,  // one JSON object per line
+    Csv         // RFC 4180, header row naming the columns
+};
+
+struct BulkParseResult {
+    QList<Rule> rules;          // in file order, conditions not yet compiled
+    qsizetype rejected = 0;     // records that did not parse
+    QString error;              // set if the input could not be read at all
+    QString firstRejection;     // what was wrong with the first rejected record
+};
+
+/**
+ * @brief Bulk rule catalogs as JSON Lines or CSV
+ *
+ * Records use the Rule field names (id, customerName, productName,
+ * quantity, price, status, createdAt, updatedAt, condition); timestamps
+ * are epoch milliseconds, ISO 8601 is accepted on input. Unknown fields
+ * and columns are ignored.
+ *
+ * parseFile() maps the file, cuts it into chunks at record boundaries and
+ * parses the chunks on QThreadPool::globalInstance(); the result keeps
+ * file order. write() streams records through a small buffer.
+ */
+class RuleBulkIo
+{
+public:
+    // .csv is CSV, anything else JSON Lines
+    static BulkFormat formatForPath(const QString& path);
+
+    static BulkParseResult parseFile(const QString& path, BulkFormat format);
+    static BulkParseResult parse(QByteArrayView data, BulkFormat format, int chunks = 0);
+
+    static bool write(QIODevice* device, const QList<Rule>& rules, BulkFormat format);
+
+    // Inputs below this are parsed on the calling thread
+    static constexpr qsizetype MIN_CHUNK_BYTES = 1 << 20;
+};
+
+} // namespace rules
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <QStringList>
+#include <QVariantMap>
+#include <memory>
+
+namespace mpf { class IEventBus; }
+
+namespace rules {
+
+class WindowAggregator;
+class CorrelationStore;
+class RulesService;
+class CompiledRuleSet;
+class ShadowEvaluator;
+class ShardedChecker;
+class ResultPublisher;
+class WorkStealingPool;
+
+/**
+ * @brief Stateful processing of orders/* EventBus traffic
+ *
+ * Keeps per-customer window aggregates of orders/created events
+ * (customerName, totalAmount) so rules can ask for history such as
+ * "orders in the last 10 minutes" or "amount today":
+ * - orders10m: sliding 10 minutes, 1 minute resolution
+ * - ordersDaily: tumbling UTC day
+ *
+ * At most MPF_RULES_WINDOW_MAX_KEYS customers (default 100000) are
+ * tracked; idle customers expire once both windows are empty.
+ *
+ * It also remembers a projection of each orders/created payload by
+ * orderId (CorrelationStore), so later orders/status_changed handling can
+ * see the order's amount and customer without asking the orders plugin.
+ * The join currently only tracks the status and logs; rules are evaluated
+ * on orders/created alone.
+ * Entries live MPF_RULES_CORRELATION_TTL_S seconds after their last
+ * event (default 86400), at most MPF_RULES_CORRELATION_MAX_ORDERS
+ * (default 200000).
+ *
+ * Each orders/created event is checked against the conditions of all
+ * "active" rules in RulesService (its current CompiledRuleSet). Condition fields are payload paths
+ * (totalAmount, customer.tier) or window.<name>.<count|sum|min|max> for
+ * the ordering customer, the current order included. A rule whose
+ * condition holds fails the check; results are published in batches on
+ * rules/check/batch by a ResultPublisher (at most MPF_RULES_RESULT_BATCH
+ * results, default 256, or MPF_RULES_RESULT_DELAY_MS, default 20, after
+ * the first). MPF_RULES_SPLIT_RESULTS=1 also publishes each result on
+ * rules/check/completed as {orderId, passed, matchedRules, reason,
+ * checkedAt}.
+ *
+ * Checks run on a WorkStealingPool of MPF_RULES_EVAL_THREADS workers
+ * (default: one per core), sharded by customer so one customer's results
+ * are published in event order; aggregation stays on this thread.
+ * Results are memoized per shard on the fields the rules read
+ * (MPF_RULES_MEMO_ENTRIES, default 65536; 0 disables).
+ *
+ * While RulesService holds a staged candidate set, every checked event is
+ * also handed to a ShadowEvaluator, which evaluates the candidate on a
+ * low-priority thread and reports divergences; published results always
+ * come from the active set.
+ */
+class RuleEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RuleEngine(const QString& pluginId, QObject* parent = nullptr);
+    ~RuleEngine() override;
+
+    // Subscribes to orders/** (delivered through EventScheduler) and
+    // publishes check results on the bus
+    void connectToEventBus(mpf::IEventBus* eventBus);
+    void setRulesService(RulesService* rulesService);
+
+    // {window name: {count, sum, min, max}} for one customer
+    QVariantMap customerWindows(const QString& customer) const;
+
+    WindowAggregator& aggregator() { return *m_aggregator; }
+    CorrelationStore& orders() { return *m_orders; }
+
+public slots:
+    void onEventReceived(const QString& topic, const QVariantMap& data,
+                         const QString& senderId);
+
+private slots:
+    void expireIdleKeys();
+
+private:
+    void onOrderCreated(const QVariantMap& data, qint64 nowMs);
+    void onOrderStatusChanged(const QVariantMap& data, qint64 nowMs);
+    void checkOrder(const QVariantMap& data, const QString& orderId,
+                    const QString& customer, qint64 nowMs);
+
+    QString m_pluginId;
+    mpf::IEventBus* m_eventBus = nullptr;
+    RulesService* m_rulesService = nullptr;
+    std::unique_ptr<WindowAggregator> m_aggregator;
+    std::unique_ptr<CorrelationStore> m_orders;
+    // Destroyed bottom-up: the checker waits for its pool tasks, which
+    // may still feed the shadow evaluator
+    std::unique_ptr<ResultPublisher> m_results;
+    std::unique_ptr<WorkStealingPool> m_pool;
+    std::unique_ptr<ShadowEvaluator> m_shadow;
+    std::unique_ptr<ShardedChecker> m_checker;
+    QTimer m_expiryTimer;
+};
+
+} // namespace rules
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <memory>
+#include <vector>
+
+namespace rules::expr {
+
+/**
+ * @brief Rule condition language
+ *
+ *   totalAmount > 10000 && customer.tier != "gold"
+ *   window.orders10m.count >= 5 || !(status == 'paid')
+ *
+ * Literals: numbers, "strings" / 'strings', true, false, null.
+ * Fields: dotted paths resolved by the caller (see FieldTable).
+ * Operators by precedence: || ; && ; == != ; < <= > >= ; + - ; * / % ;
+ * unary ! and -. && and || short-circuit and yield booleans.
+ *
+ * Conditions are compiled once into a Program: constant subtrees are
+ * folded, field paths become slot numbers, and operands address
+ * registers, constants or fields directly, so "field > constant" is one
+ * instruction.
+ */
+enum class ValueType : quint8 {
+    Null,
+    Bool,
+    Number,
+    String
+};
+
+struct Value {
+    ValueType type = ValueType::Null;
+    double number = 0;      // also 0/1 for Bool
+    QString string;
+
+    static Value fromBool(bool value) { return {ValueType::Bool, value ? 1.0 : 0.0, {}}; }
+    static Value fromNumber(double value) { return {ValueType::Number, value, {}}; }
+    static Value fromString(const QString& value) { return {ValueType::String, 0, value}; }
+    static Value fromVariant(const QVariant& value);
+
+    QVariant toVariant() const;
+    bool truthy() const;
+};
+
+/**
+ * @brief Append-only mapping of field paths to slots
+ *
+ * Every program compiled against a table reads its fields from a Value
+ * array indexed by these slots.
+ */
+class FieldTable
+{
+public:
+    int slot(const QString& path);          // adds the path if needed; -1 when full
+    int find(const QString& path) const;
+    int size() const { return static_cast<int>(m_paths.size()); }
+    const QString& path(int slot) const { return m_paths.at(slot); }
+
+private:
+    QHash<QString, int> m_slots;
+    QStringList m_paths;
+};
+
+enum class OpCode : quint8 {
+    Truthy,
+    Not,
+    Neg,
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Mod,
+    Eq,
+    Ne,
+    Lt,
+    Le,
+    Gt,
+    Ge,
+    Jump,
+    JumpIfFalse,
+    JumpIfTrue,
+    Return
+};
+
+// Operands: 2-bit kind (register, constant, field) + 14-bit index
+struct Instruction {
+    OpCode op;
+    quint8 dst;
+    quint16 a;
+    quint16 b;      // second operand, or jump target
+};
+
+class Program
+{
+public:
+    static constexpr int MAX_REGISTERS = 32;
+
+    // Compile limits. The source length bounds the syntax tree (and so the
+    // recursion in folding, code generation and teardown), the nesting
+    // depth bounds parser recursion, and jump targets are 16-bit.
+    static constexpr int MAX_SOURCE_LENGTH = 4096;
+    static constexpr int MAX_NESTING = 64;
+    static constexpr int MAX_INSTRUCTIONS = 0xFFFF;
+
+    // fields: one Value per FieldTable slot (at least maxFieldSlot() + 1)
+    Value evaluate(const Value* fields) const;
+    bool matches(const Value* fields) const { return evaluate(fields).truthy(); }
+
+    const QString& source() const { return m_source; }
+
+    // Distinct slots this program reads, ascending
+    const std::vector<int>& fieldSlots() const { return m_fieldSlots; }
+    int maxFieldSlot() const { return m_fieldSlots.empty() ? -1 : m_fieldSlots.back(); }
+
+    int instructionCount() const { return static_cast<int>(m_code.size()); }
+    QString disassemble() const;
+
+private:
+    friend class Compiler;
+
+    QString m_source;
+    std::vector<Instruction> m_code;
+    std::vector<Value> m_constants;
+    std::vector<int> m_fieldSlots;
+};
+
+struct CompileResult {
+    std::shared_ptr<const Program> program;     // null on error
+    QString error;
+};
+
+CompileResult compile(const QString& source, FieldTable& fields);
+
+} // namespace rules::expr
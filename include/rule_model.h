@@ -8,13 +8,30 @@ namespace rules {
 /**
  * @brief List model for rules
  * 
- * Exposes rules to QML ListView/Repeater.
+ * Exposes rules to QML ListView/Repeater. Follows RulesService through its
+ * change feed: batches of up to MAX_DELTA_CHANGES changes become row
+ * inserts, removals and dataChanged; resets and larger bursts rebuild the
+ * model.
+ *
+ * Rows follow the service's (creation) order unless sortBy is "createdAt"
+ * or "updatedAt", which lists the newest first from the service's time
+ * index; limit > 0 then keeps only that many rows ("newest 50"). With a
+ * filterStatus as well, a large store builds that window on a worker, since
+ * skipping other statuses in the index can visit every entry.
+ *
+ * Rebuilding the rows of a large store (filter, sort, conversion) runs on
+ * a worker over a snapshot via RulesService::readAsync(); the GUI thread
+ * only swaps the result in. loading is true meanwhile, and a newer filter
+ * or sort cancels a build still in flight.
  */
 class RuleModel : public QAbstractListModel
 {
     Q_OBJECT
     Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
     Q_PROPERTY(QString filterStatus READ filterStatus WRITE setFilterStatus NOTIFY filterStatusChanged)
+    Q_PROPERTY(QString sortBy READ sortBy WRITE setSortBy NOTIFY sortByChanged)
+    Q_PROPERTY(int limit READ limit WRITE setLimit NOTIFY limitChanged)
+    Q_PROPERTY(bool loading READ loading NOTIFY loadingChanged)
     Q_PROPERTY(rules::RulesService* service READ service WRITE setService NOTIFY serviceChanged)
 
 public:
@@ -43,9 +60,22 @@ public:
     QHash<int, QByteArray> roleNames() const override;
 
     // Filter
-    QString filterStatus() const { return m_filterStatus; }
+    QString filterStatus() const { return m_view.filterStatus; }
     void setFilterStatus(const QString& status);
 
+    // Time-sorted view
+    QString sortBy() const { return m_view.sortBy; }
+    void setSortBy(const QString& sortBy);
+    int limit() const { return m_view.limit; }
+    void setLimit(int limit);
+
+    bool loading() const { return m_loading; }
+
+    // Stores smaller than this are rebuilt in place
+    static constexpr qsizetype ASYNC_MIN_RULES = 10000;
+    // Change batches larger than this rebuild instead of applying row deltas
+    static constexpr qsizetype MAX_DELTA_CHANGES = 64;
+
     // Actions
     Q_INVOKABLE void refresh();
     Q_INVOKABLE QVariantMap get(int index) const;
@@ -53,17 +83,53 @@ public:
 signals:
     void countChanged();
     void filterStatusChanged();
+    void sortByChanged();
+    void limitChanged();
+    void loadingChanged();
     void serviceChanged();
 
 private slots:
     void onRulesChanged();
 
 private:
+    // Which rules are shown and in what order; copied to row builders
+    struct View {
+        QString filterStatus;
+        QString sortBy;
+        int limit = 0;
+
+        bool accepts(const Rule& rule) const;
+        bool timeSorted() const;
+        qint64 rowKey(const Rule& rule) const;     // time-sorted views only
+    };
+
+    struct Rows {
+        QVariantList rules;
+        QStringList ids;
+        QList<qint64> keys;
+    };
+
+    // Stops early (empty result) once promise is canceled
+    static Rows buildRows(const QList<Rule>& rules, const View& view, const QPromise<Rows>* promise);
+
     void updateFilteredRules();
+    void resetRows(Rows rows, quint64 sequence);
+    void setLoading(bool loading);
+    bool applyChange(const RuleChange& change);
+    qsizetype storeOrderRow(qsizetype storeRow) const;
+    void insertRow(qsizetype row, const Rule& rule, qint64 key);
+    void removeRow(qsizetype row);
 
     RulesService* m_service = nullptr;
     QVariantList m_filteredRules;
-    QString m_filterStatus;
+    QStringList m_rowIds;           // parallel to m_filteredRules
+    QList<qint64> m_rowKeys;        // ascending View::rowKey(); store row when inserted if untimed
+    quint64 m_sequence = 0;         // change feed position of the rows
+    View m_view;
+
+    QFuture<Rows> m_pendingLoad;
+    quint64 m_load = 0;             // bumped by every rebuild; stale results are dropped
+    bool m_loading = false;
 };
 
 } // namespace rules
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "rule_expression.h"
+
+#include <QHash>
+#include <QString>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace rules {
+
+struct CompiledRule {
+    QString id;
+    QString name;
+    std::shared_ptr<const expr::Program> program;
+};
+
+/**
+ * @brief Immutable snapshot of the rules evaluators run
+ *
+ * Built off the GUI thread from the active, conditional rules of one
+ * RulesService version and never modified afterwards, so any number of
+ * threads can evaluate against it without locks.
+ */
+class CompiledRuleSet
+{
+public:
+    static std::unique_ptr<CompiledRuleSet> build(quint64 version,
+                                                  const QHash<QString, CompiledRule>& rules,
+                                                  const expr::FieldTable& fields);
+
+    quint64 version = 0;
+    expr::FieldTable fields;
+    std::vector<CompiledRule> rules;      // ordered by rule id
+    std::vector<int> fieldSlots;          // union of slots the rules read
+};
+
+/**
+ * @brief Publication point for the current CompiledRuleSet
+ *
+ * publish() swaps the pointer atomically and retires the previous set
+ * through rules::epoch, so readers see either the old or the new set in
+ * full and never a freed one:
+ *
+ *   epoch::Guard guard;
+ *   const CompiledRuleSet* set = slot.acquire();
+ */
+class RuleSetSlot
+{
+public:
+    RuleSetSlot();
+    ~RuleSetSlot();     // no readers may remain
+
+    // Valid while the caller holds an epoch::Guard; never null
+    const CompiledRuleSet* acquire() const { return m_current.load(std::memory_order_seq_cst); }
+
+    void publish(std::unique_ptr<CompiledRuleSet> set);
+    quint64 version() const { return acquire()->version; }
+    quint64 swapCount() const { return m_swaps.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<const CompiledRuleSet*> m_current;
+    std::atomic<quint64> m_swaps{0};
+};
+
+} // namespace rules
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVariantMap>
+#include <atomic>
+
+namespace mpf { class IEventBus; }
+
+namespace rules {
+
+/**
+ * @brief Process-wide lock-free counters and gauges
+ *
+ * Hot paths update these with relaxed atomics only; RulesMetrics reads
+ * them when it builds a snapshot.
+ */
+struct MetricCounters {
+    // Counters
+    std::atomic<quint64> mutations{0};
+    std::atomic<quint64> rulesChangedEmitted{0};
+    std::atomic<quint64> modelResets{0};
+    std::atomic<quint64> modelDeltas{0};
+    std::atomic<quint64> changeFeedResets{0};
+    std::atomic<quint64> eventsReceived{0};
+    std::atomic<quint64> eventsFiltered{0};
+    std::atomic<quint64> eventsDropped{0};
+    std::atomic<quint64> eventsShed{0};
+    std::atomic<quint64> eventsExpired{0};
+    std::atomic<quint64> orderEvents{0};
+    std::atomic<quint64> windowKeysEvicted{0};
+    std::atomic<quint64> correlationHits{0};
+    std::atomic<quint64> correlationMisses{0};
+    std::atomic<quint64> conditionsEvaluated{0};
+    std::atomic<quint64> conditionsMatched{0};
+    std::atomic<quint64> resultBatches{0};
+    std::atomic<quint64> resultsPublished{0};
+    std::atomic<quint64> memoHits{0};
+    std::atomic<quint64> memoMisses{0};
+    std::atomic<quint64> memoSavedNs{0};
+    std::atomic<quint64> shadowEvaluated{0};
+    std::atomic<quint64> shadowDivergent{0};
+    std::atomic<quint64> shadowShed{0};
+    std::atomic<quint64> shadowActiveNs{0};
+    std::atomic<quint64> shadowCandidateNs{0};
+    std::atomic<quint64> logRecordsDropped{0};
+
+    // Gauges
+    std::atomic<qint64> messageQueueDepth{0};
+    std::atomic<qint64> eventsQueued{0};
+    std::atomic<qint64> httpQueued{0};
+    std::atomic<qint64> httpInFlight{0};
+    std::atomic<qint64> ruleCount{0};
+    std::atomic<qint64> windowKeys{0};
+    std::atomic<qint64> correlatedOrders{0};
+};
+
+namespace metrics {
+
+inline void count(std::atomic<quint64>& counter, quint64 n = 1)
+{
+    counter.fetch_add(n, std::memory_order_relaxed);
+}
+
+inline void gauge(std::atomic<qint64>& value, qint64 current)
+{
+    value.store(current, std::memory_order_relaxed);
+}
+
+} // namespace metrics
+
+/**
+ * @brief Runtime metrics for the rules plugin
+ *
+ * Exposed to QML as the RulesMetrics singleton and published as a
+ * snapshot on the "rules/metrics" EventBus topic every publishIntervalMs
+ * (MPF_RULES_METRICS_INTERVAL_MS, default 5000; 0 disables publishing).
+ */
+class RulesMetrics : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariantMap snapshot READ snapshot NOTIFY snapshotChanged)
+    Q_PROPERTY(int publishIntervalMs READ publishIntervalMs WRITE setPublishIntervalMs NOTIFY publishIntervalMsChanged)
+
+public:
+    explicit RulesMetrics(const QString& pluginId, QObject* parent = nullptr);
+    ~RulesMetrics() override;
+
+    static MetricCounters& counters();
+
+    QVariantMap snapshot() const;
+
+    int publishIntervalMs() const { return m_publishIntervalMs; }
+    void setPublishIntervalMs(int intervalMs);
+
+    // Starts periodic publishing; without an EventBus only QML sees updates
+    void setEventBus(mpf::IEventBus* eventBus);
+
+signals:
+    void snapshotChanged();
+    void publishIntervalMsChanged();
+
+private slots:
+    void tick();
+
+private:
+    QString m_pluginId;
+    mpf::IEventBus* m_eventBus = nullptr;
+    QTimer m_timer;
+    int m_publishIntervalMs = 5000;
+
+    // Rates are derived from the counter deltas between two ticks
+    QElapsedTimer m_sinceLastTick;
+    quint64 m_lastMutations = 0;
+    quint64 m_lastEventsReceived = 0;
+    double m_mutationsPerSecond = 0;
+    double m_eventsPerSecond = 0;
+};
+
+} // namespace rules
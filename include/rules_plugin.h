@@ -2,11 +2,22 @@
 
 #include <QObject>
 #include <mpf/interfaces/iplugin.h>
+#include <QStringList>
+#include <QVariantMap>
+#include <memory>
+
+namespace mpf {
+class IMenu;
+}
 
 namespace rules {
 
 class RulesService;
 class DemoService;
+class RuleEngine;
+class EventScheduler;
+class RulesServiceApi;
+class RulesMetrics;
 
 /**
  * @brief Rules plugin implementation
@@ -34,13 +45,37 @@ public:
   QString qmlModuleUri() const override { return "Biiz.Rules"; }
   QString entryQml() const override { return QString(); }
 
+private slots:
+  void onEventBusActivity(const QString &topic, const QVariantMap &data,
+                          const QString &senderId);
+
 private:
   void registerRoutes();
   void registerQmlTypes();
 
+  // Lazy activation: services are created on first QML singleton access
+  // or first matching EventBus event (MPF_RULES_EAGER_INIT=1 disables it)
+  void createServices();
+  void connectServices();
+  void loadInitialData();
+  void saveHandoff();
+  bool adoptHandoff();
+  void activate(const char *trigger);
+  void watchEventBus();
+  void stopWatchingEventBus();
+
   mpf::ServiceRegistry *m_registry = nullptr;
+  mpf::IMenu *m_menu = nullptr;
+  QObject *m_eventBusObj = nullptr;
+  QStringList m_activationSubIds;
+  bool m_lazyActivation = true;
+  qint64 m_startupNs = 0;
   std::unique_ptr<RulesService> m_rulesService;
   std::unique_ptr<DemoService> m_demoService;
+  std::unique_ptr<RuleEngine> m_ruleEngine;
+  std::unique_ptr<EventScheduler> m_scheduler;
+  std::unique_ptr<RulesMetrics> m_metrics;
+  std::unique_ptr<RulesServiceApi> m_api;
 };
 
 } // namespace rules
@@ -4,6 +4,22 @@
 #include <QList>
 #include <QVariantMap>
 #include <QDateTime>
+#include <QFuture>
+#include <QJSValue>
+#include <QPromise>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QHash>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "rule_expression.h"
+#include "rule_set.h"
+#include "time_index.h"
+#include "string_pool.h"
+
+class QIODevice;
 
 namespace rules {
 
@@ -13,19 +29,49 @@ struct Rule {
     QString productName;
     int quantity;
     double price;
-    QString status;  // pending, processing, shipped, delivered, cancelled
+    // pending, active, processing, shipped, delivered, cancelled. Only
+    // "active" rules have their condition evaluated by RuleEngine.
+    QString status;
     QDateTime createdAt;
     QDateTime updatedAt;
+    QString condition;  // rule_expression.h syntax; empty = no condition
+
+    // Compiled once by RulesService when the condition is set
+    std::shared_ptr<const expr::Program> program;
     
     QVariantMap toVariantMap() const;
     static Rule fromVariantMap(const QVariantMap& map);
 };
 
+/**
+ * @brief One entry of the RulesService change feed
+ */
+struct RuleChange {
+    enum Kind { Created, Updated, Deleted };
+
+    quint64 sequence = 0;
+    Kind kind = Created;
+    Rule rule;      // state after the change; the last state for Deleted
+};
+
+/**
+ * @brief Result of RulesService::changesSince()
+ *
+ * Either the changes after the consumer's sequence number, oldest first,
+ * or (reset) the whole rule store to replace local state with.
+ */
+struct ChangeSet {
+    quint64 sequence = 0;       // pass to the next changesSince()
+    bool reset = false;
+    QList<RuleChange> changes;
+    QList<Rule> rules;          // only with reset
+};
+
 /**
  * @brief Rules business service
  * 
- * Provides rule management functionality.
- * This could be exposed as an interface if other plugins need it.
+ * Provides rule management functionality. Other plugins reach it through
+ * IRulesService (RulesServiceApi), not directly.
  */
 class RulesService : public QObject
 {
@@ -41,6 +87,17 @@ public:
     Q_INVOKABLE QString createRule(const QVariantMap& data);
     Q_INVOKABLE bool updateRule(const QString& id, const QVariantMap& data);
     Q_INVOKABLE bool deleteRule(const QString& id);
+
+    // Bulk: one store update, one rule set build and one rulesChanged for
+    // the whole batch (no per-rule ruleCreated). Missing or clashing ids
+    // are replaced, missing timestamps set to now; rules whose condition
+    // does not compile are skipped. Returns the number inserted.
+    qsizetype insertRules(QList<Rule> rules);
+
+    // JSON Lines or CSV by extension (see RuleBulkIo). importRules returns
+    // the number of rules added, or -1 if the file could not be read.
+    Q_INVOKABLE int importRules(const QString& path);
+    Q_INVOKABLE bool exportRules(const QString& path) const;
     
     // Business operations
     Q_INVOKABLE bool updateStatus(const QString& id, const QString& status);
@@ -48,6 +105,82 @@ public:
     Q_INVOKABLE int getRuleCount() const;
     Q_INVOKABLE double getTotalRevenue() const;
 
+    // Asynchronous reads: run on QThreadPool::globalInstance() against a
+    // snapshot of the store taken at the call, O(1) since the rule list is
+    // implicitly shared (the store copies on its next mutation instead).
+    // QFuture::cancel() stops the worker at its next check.
+    QFuture<QVariantList> getAllRulesAsync() const;
+    QFuture<QVariantList> getRulesByStatusAsync(const QString& status) const;
+    QFuture<double> getTotalRevenueAsync() const;
+
+    // Generic form: read(promise, rules) on a worker; read should return
+    // early once promise.isCanceled()
+    template<typename T, typename Read>
+    QFuture<T> readAsync(Read read) const
+    {
+        return QtConcurrent::run([rules = m_rules, read = std::move(read)](QPromise<T>& promise) {
+            read(promise, rules);
+        });
+    }
+
+    // QML: callback(total) on this thread once computed
+    Q_INVOKABLE void fetchTotalRevenue(const QJSValue& callback);
+
+    // Time queries over ordered createdAt/updatedAt indexes: the cost is
+    // O(log n) plus the index entries visited, not a scan of the store.
+    enum class TimeField { CreatedAt, UpdatedAt };
+    // fromMs <= field <= toMs, oldest first; limit < 0 = all
+    QList<Rule> rulesInTimeRange(TimeField field, qint64 fromMs, qint64 toMs, qsizetype limit = -1) const;
+    // The `count` most recent (count < 0 = all), newest first, optionally of
+    // one status. The index is not keyed by status: a filter skips entries
+    // of other statuses, up to the whole index when the status is rare.
+    QList<Rule> recentRules(TimeField field, qsizetype count, const QString& status = QString()) const;
+    Q_INVOKABLE QVariantList getRulesModifiedBetween(const QDateTime& from, const QDateTime& to) const;
+    Q_INVOKABLE QVariantList getRecentRules(int count) const;
+
+    // Conditions: createRule/updateRule reject rules whose condition does
+    // not compile. Returns the compile error, or an empty string if valid.
+    Q_INVOKABLE QString checkCondition(const QString& condition) const;
+
+    // Rule store (GUI thread only); generation() changes with every mutation
+    const QList<Rule>& rules() const { return m_rules; }
+    quint64 generation() const { return m_generation; }
+    qsizetype rowOf(const QString& id) const { return m_rowById.value(id, -1); }  // -1 if absent
+
+    // What evaluators run: the active rules with conditions, as an
+    // immutable CompiledRuleSet. Mutations that touch such a rule rebuild
+    // the set on a worker and swap it in atomically; edits arriving while
+    // a build runs are coalesced into the next one. Safe from any thread.
+    const RuleSetSlot& compiledRules() const { return *m_ruleSets; }
+
+    // Change feed: generation() is the sequence number of the latest
+    // mutation, and the last MPF_RULES_CHANGE_LOG (default 4096) changes
+    // are kept. changesSince(seq) returns the changes after seq, or a reset
+    // snapshot when the log no longer reaches back that far or the store
+    // was replaced as a whole (readSnapshot). GUI thread only.
+    ChangeSet changesSince(quint64 sequence) const;
+    Q_INVOKABLE QVariantMap getChangesSince(qint64 sequence) const;
+    void setChangeLogCapacity(int capacity);
+
+    // Shadow mode: staged condition changes form a candidate rule set that
+    // RuleEngine evaluates next to the active one, off the event path,
+    // without acting on its decisions. An empty condition stages removal.
+    Q_INVOKABLE bool stageCondition(const QString& id, const QString& condition);
+    Q_INVOKABLE void discardCandidate();
+    Q_INVOKABLE bool promoteCandidate();
+    Q_INVOKABLE int stagedCount() const { return m_staged.size(); }
+
+    bool hasCandidate() const { return m_hasCandidate.load(std::memory_order_acquire); }
+    const RuleSetSlot& candidateRules() const { return *m_candidateSets; }
+
+    // Warm restart: compact binary snapshot of the rule store, written in
+    // stop() and adopted by the next instance without going through
+    // QVariantMap conversion. readSnapshot() replaces the current rules and
+    // rebuilds what is derived from them (compiled conditions, id hash,
+    // time indexes, interned strings); the snapshot holds records only.
+    bool writeSnapshot(QIODevice* device) const;
+    bool readSnapshot(QIODevice* device);
+
 signals:
     void ruleCreated(const QString& id);
     void ruleUpdated(const QString& id);
@@ -56,8 +189,65 @@ signals:
 
 private:
     QString generateId() const;
+    const Rule* findRule(const QString& id) const;
+    Rule* findRule(const QString& id);
+    const TimeIndex& timeIndex(TimeField field) const
+    {
+        return field == TimeField::CreatedAt ? m_createdIndex : m_updatedIndex;
+    }
+    void indexTimes(const Rule& rule);
+    void unindexTimes(const Rule& rule);
+    void internStrings(Rule& rule);
+    void releaseStrings();
+    void recordMutation();
+    void notifyRulesChanged();
+    void recordChange(RuleChange::Kind kind, const Rule& rule);
+    bool compileCondition(Rule& rule);
+    bool indexCondition(const Rule& rule);
+    void scheduleRuleSetBuild();
+    void scheduleCandidateBuild();
+    void startBuilderLocked();
+    void runRuleSetBuilds();
+    QHash<QString, CompiledRule> candidateConditions() const;
     
     QList<Rule> m_rules;
+    QHash<QString, qsizetype> m_rowById;
+    TimeIndex m_createdIndex;
+    TimeIndex m_updatedIndex;
+    StringPool m_strings;               // customerName, productName, status
+    qsizetype m_releasedStrings = 0;    // rules dropped or edited since the last purge
+    quint64 m_generation = 0;
+    expr::FieldTable m_fields;
+
+    std::deque<RuleChange> m_changeLog;
+    quint64 m_changeFloor = 0;      // oldest sequence the log can serve from
+    size_t m_changeLogCapacity = 4096;
+
+    // Input of the next rule set build (implicitly shared copies)
+    struct RuleSetSource {
+        quint64 version = 0;
+        QHash<QString, CompiledRule> rules;
+        expr::FieldTable fields;
+    };
+
+    struct StagedCondition {
+        QString condition;
+        std::shared_ptr<const expr::Program> program;   // null = removed in the candidate
+    };
+
+    QHash<QString, CompiledRule> m_conditional;     // active rules with a program
+    QHash<QString, StagedCondition> m_staged;
+    quint64 m_conditionsVersion = 0;
+    quint64 m_candidateVersion = 0;
+    std::unique_ptr<RuleSetSlot> m_ruleSets;
+    std::unique_ptr<RuleSetSlot> m_candidateSets;
+    std::atomic<bool> m_hasCandidate{false};    // candidate built and current
+    bool m_candidateStaged = false;             // guarded by m_buildMutex
+    std::mutex m_buildMutex;
+    std::optional<RuleSetSource> m_pendingBuild;
+    std::optional<RuleSetSource> m_pendingCandidateBuild;
+    bool m_buildRunning = false;
+    QFuture<void> m_buildFuture;
 };
 
 } // namespace rules
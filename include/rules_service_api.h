@@ -0,0 +1,68 @@
+#pragma once
+
+#include "irules_service.h"
+
+#include <QObject>
+#include <atomic>
+#include <functional>
+
+namespace rules {
+
+/**
+ * @brief IRulesService on top of the plugin's RulesService
+ *
+ * Registered at initialize(), before the services exist: the first call
+ * runs the activator (on the context object's thread, blocking a caller
+ * from another thread) and the result is cached. After shutdown() every
+ * call behaves as if no rules existed and the activator never runs again.
+ *
+ * Every call holds the service for its duration; shutdown() waits for the
+ * calls already past that point, so the service can be destroyed once it
+ * returns.
+ */
+class RulesServiceApi : public IRulesService
+{
+public:
+    using Activator = std::function<RulesService*()>;
+
+    RulesServiceApi(QObject* context, Activator activate);
+
+    // Called by RulesPlugin::stop() once the interface is unregistered;
+    // returns when no call uses the service any more
+    void shutdown();
+
+    quint64 evaluate(const OrderRecord* orders, qsizetype count,
+                     EvaluationResult* results, std::vector<QString>& matches) const override;
+
+    RuleHandle find(const QString& id) const override;
+    const Rule* rule(RuleHandle handle) const override;
+    RulesSnapshot snapshot() const override;
+
+private:
+    // The service for one call, null once shut down; shutdown() waits for
+    // live instances
+    class Call
+    {
+    public:
+        explicit Call(const RulesServiceApi& api);
+        ~Call();
+        Call(const Call&) = delete;
+        Call& operator=(const Call&) = delete;
+
+        const RulesService* service() const { return m_service; }
+
+    private:
+        const RulesServiceApi& m_api;
+        const RulesService* m_service = nullptr;
+    };
+
+    RulesService* service() const;
+
+    QObject* m_context;
+    Activator m_activate;
+    mutable std::atomic<RulesService*> m_service{nullptr};
+    std::atomic<bool> m_stopped{false};
+    mutable std::atomic<int> m_inFlight{0};
+};
+
+} // namespace rules
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "rule_expression.h"
+
+#include <QStringList>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+class QThread;
+
+namespace rules {
+
+class RuleSetSlot;
+
+/**
+ * @brief One event as the active rule set saw it
+ */
+struct ShadowJob {
+    QString orderId;
+    quint64 candidateVersion = 0;       // the candidate set fields were bound for
+    std::vector<expr::Value> fields;    // bound for both sets' slots
+    QStringList activeMatched;          // in rule id order
+    qint64 activeNs = -1;               // -1: answered from the memo, not timed
+};
+
+/**
+ * @brief Evaluates a candidate rule set on a lowest-priority thread
+ *
+ * submit() never blocks the event path: when the worker is busy with the
+ * queue lock or the queue is full the job is shed (and counted), as is a
+ * job whose candidate set was restaged before the worker reached it. The
+ * worker compares the candidate's matches with the active ones and, for
+ * events the active set evaluated rather than recalled from the memo,
+ * accumulates both evaluation times in RulesMetrics.
+ */
+class ShadowEvaluator
+{
+public:
+    explicit ShadowEvaluator(const RuleSetSlot& candidates, size_t capacity = 256);
+    ~ShadowEvaluator();
+
+    // false if the job was shed
+    bool submit(ShadowJob&& job);
+
+private:
+    void run();
+    void evaluate(const ShadowJob& job);
+
+    const RuleSetSlot& m_candidates;
+    const size_t m_capacity;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<ShadowJob> m_queue;
+    bool m_stopping = false;
+    QThread* m_thread = nullptr;
+};
+
+} // namespace rules
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "window_aggregator.h"
+
+#include <QStringList>
+#include <QVariantMap>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace rules {
+
+class RulesService;
+class ShadowEvaluator;
+class WorkStealingPool;
+
+/**
+ * @brief One orders/created event to check, with the state it needs
+ *
+ * The window stats are captured by the caller (which owns the
+ * aggregator), so the check itself touches no shared mutable state.
+ */
+struct CheckRequest {
+    QString orderId;
+    QString customer;
+    QVariantMap data;
+    std::vector<WindowStats> windows;   // per WindowSpec, this order included
+    qint64 nowMs = 0;
+};
+
+struct CheckResult {
+    QString orderId;
+    QStringList matchedRules;   // in rule id order
+    QStringList reasons;        // matched rule names
+    qint64 checkedAt = 0;
+};
+
+/**
+ * @brief Evaluates condition checks on a WorkStealingPool, ordered per key
+ *
+ * Requests are sharded by customer (orderId when there is none). A shard
+ * is a mailbox drained by at most one pool task at a time, so requests
+ * with the same key are checked, and their results delivered, in submit
+ * order; different shards run on whichever workers are free. The result
+ * handler runs on pool threads.
+ */
+class ShardedChecker
+{
+public:
+    using ResultHandler = std::function<void(const CheckResult&)>;
+
+    ShardedChecker(const RulesService& rules, WorkStealingPool& pool,
+                   std::vector<WindowSpec> windows, int shardCount,
+                   ResultHandler onResult, ShadowEvaluator* shadow = nullptr,
+                   size_t memoEntries = 0);
+    ~ShardedChecker();      // waits for submitted checks
+
+    // Call from a single thread to get per-key ordering
+    void submit(CheckRequest&& request);
+    void waitForIdle();
+
+    int shardCount() const { return static_cast<int>(m_shards.size()); }
+
+private:
+    struct Shard;
+
+    void drain(Shard& shard);
+    void check(Shard& shard, const CheckRequest& request);
+
+    const RulesService& m_rules;
+    WorkStealingPool& m_pool;
+    const std::vector<WindowSpec> m_windows;
+    ResultHandler m_onResult;
+    ShadowEvaluator* m_shadow;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+
+    std::atomic<qint64> m_pending{0};
+    std::mutex m_idleMutex;
+    std::condition_variable m_idle;
+};
+
+} // namespace rules
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QSet>
+#include <QString>
+#include <iterator>
+
+namespace rules {
+
+/**
+ * @brief Interns repeated rule field values
+ *
+ * Rules repeat a handful of statuses and a bounded set of customer and
+ * product names. Interned, every equal value shares one implicitly shared
+ * buffer, so the store holds one allocation per distinct value instead of
+ * one per field per rule. purge() drops values only the pool still holds.
+ */
+class StringPool
+{
+public:
+    // Replaces value with the pooled copy, adding it if new
+    void intern(QString& value)
+    {
+        if (value.isEmpty()) {
+            return;
+        }
+        auto it = m_values.constFind(value);
+        if (it != m_values.cend()) {
+            value = *it;
+        } else {
+            m_values.insert(value);
+        }
+    }
+
+    void purge()
+    {
+        for (auto it = m_values.begin(); it != m_values.end();) {
+            it = it->isDetached() ? m_values.erase(it) : std::next(it);
+        }
+    }
+
+    qsizetype size() const { return m_values.size(); }
+
+private:
+    QSet<QString> m_values;
+};
+
+} // namespace rules
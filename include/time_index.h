@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QDateTime>
+#include <QString>
+#include <limits>
+#include <set>
+#include <utility>
+
+namespace rules {
+
+/**
+ * @brief Ordered (epoch ms, rule id) index for range and recency scans
+ *
+ * A balanced tree over millisecond keys with the id as tie-breaker, so
+ * insert, remove and move are O(log n) and a scan costs O(log n) plus the
+ * entries it visits. Invalid timestamps sort before everything else.
+ */
+class TimeIndex
+{
+public:
+    static qint64 key(const QDateTime& time)
+    {
+        return time.isValid() ? time.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min();
+    }
+
+    void insert(qint64 ms, const QString& id) { m_entries.emplace(ms, id); }
+    void remove(qint64 ms, const QString& id) { m_entries.erase(Entry(ms, id)); }
+    void move(qint64 fromMs, qint64 toMs, const QString& id);
+    void clear() { m_entries.clear(); }
+    size_t size() const { return m_entries.size(); }
+
+    // visit(id) for fromMs <= ms <= toMs, oldest first, until it returns false
+    template<typename Visit>
+    void scan(qint64 fromMs, qint64 toMs, Visit visit) const
+    {
+        for (auto it = m_entries.lower_bound(Entry(fromMs, QString()));
+             it != m_entries.end() && it->first <= toMs; ++it) {
+            if (!visit(it->second)) {
+                return;
+            }
+        }
+    }
+
+    // visit(id) newest first until it returns false
+    template<typename Visit>
+    void scanNewest(Visit visit) const
+    {
+        for (auto it = m_entries.rbegin(); it != m_entries.rend(); ++it) {
+            if (!visit(it->second)) {
+                return;
+            }
+        }
+    }
+
+private:
+    using Entry = std::pair<qint64, QString>;
+
+    std::set<Entry> m_entries;
+};
+
+inline void TimeIndex::move(qint64 fromMs, qint64 toMs, const QString& id)
+{
+    if (fromMs != toMs) {
+        remove(fromMs, id);
+        insert(toMs, id);
+    }
+}
+
+} // namespace rules
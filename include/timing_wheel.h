@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QtGlobal>
+#include <array>
+#include <vector>
+
+namespace rules {
+
+/**
+ * @brief Hierarchical timing wheel (4 levels x 64 slots)
+ *
+ * schedule() and expiry are O(1) amortized regardless of how many timers
+ * are pending; with a 1 s tick the wheel spans 2^24 s (~194 days), later
+ * deadlines are clamped to the last slot and fire early. There is no
+ * cancel: owners re-check their own state when a timer fires and simply
+ * ignore (or re-schedule) stale ids.
+ */
+class TimingWheel
+{
+public:
+    using TimerId = quint64;
+
+    TimingWheel(qint64 tickMs, qint64 startMs);
+
+    void schedule(TimerId id, qint64 deadlineMs);
+
+    // Moves time forward and returns every timer due at or before nowMs
+    std::vector<TimerId> advance(qint64 nowMs);
+
+    size_t pending() const { return m_pending; }
+    qint64 tickMs() const { return m_tickMs; }
+
+private:
+    static constexpr int BITS = 6;
+    static constexpr int SLOTS = 1 << BITS;
+    static constexpr int MASK = SLOTS - 1;
+    static constexpr int LEVELS = 4;
+
+    struct Entry {
+        TimerId id;
+        qint64 tick;
+    };
+
+    void insert(const Entry& entry);
+    void cascade(int level, int index);
+
+    qint64 m_tickMs;
+    qint64 m_currentTick;
+    size_t m_pending = 0;
+    std::array<std::array<std::vector<Entry>, SLOTS>, LEVELS> m_levels;
+};
+
+} // namespace rules
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QString>
+
+namespace rules::trace {
+
+/**
+ * @brief Scoped trace spans, exportable as Chrome / Perfetto trace JSON
+ *
+ * Spans are only compiled in when the RULES_PLUGIN_ENABLE_TRACING CMake
+ * option is ON (it defines RULES_TRACING); otherwise RULES_TRACE_SCOPE
+ * expands to nothing. When compiled in, recording starts disabled unless
+ * MPF_RULES_TRACE_FILE is set, and a disabled span costs one relaxed
+ * atomic load. Each thread appends to its own buffer; buffers are only
+ * read by exportChromeJson().
+ */
+bool isEnabled();
+void setEnabled(bool enabled);
+
+// Writes every buffered span as {"traceEvents": [...]} (load in
+// chrome://tracing or ui.perfetto.dev). Returns false on I/O failure.
+bool exportChromeJson(const QString& path);
+void clear();
+
+class Span
+{
+public:
+    explicit Span(const char* name) noexcept;
+    ~Span();
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* m_name;     // must be a string literal
+    qint64 m_startNs;       // -1 when recording was disabled at entry
+};
+
+} // namespace rules::trace
+
+#if defined(RULES_TRACING)
+#define RULES_TRACE_CONCAT_(a, b) a##b
+#define RULES_TRACE_CONCAT(a, b) RULES_TRACE_CONCAT_(a, b)
+#define RULES_TRACE_SCOPE(name) \
+    ::rules::trace::Span RULES_TRACE_CONCAT(rulesTraceSpan_, __LINE__)(name)
+#else
+#define RULES_TRACE_SCOPE(name) ((void)0)
+#endif
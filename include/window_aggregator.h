@@ -0,0 +1,85 @@
+#pragma once
+
+#include "bounded_lru.h"
+
+#include <QString>
+#include <vector>
+
+namespace rules {
+
+enum class WindowKind {
+    Sliding,    // last lengthMs, in `buckets` steps of lengthMs / buckets
+    Tumbling    // fixed, epoch-aligned periods of lengthMs (e.g. calendar day in UTC)
+};
+
+struct WindowSpec {
+    QString name;
+    WindowKind kind = WindowKind::Sliding;
+    qint64 lengthMs = 0;
+    int buckets = 1;    // ignored for tumbling windows
+};
+
+struct WindowStats {
+    quint64 count = 0;
+    double sum = 0;
+    double min = 0;
+    double max = 0;
+};
+
+/**
+ * @brief Per-key streaming count/sum/min/max over time windows
+ *
+ * Every key owns a fixed number of buckets (the sum of all windows'
+ * buckets) in one flat array, so memory per key is constant no matter how
+ * many events it sees. A sliding window combines the buckets still inside
+ * it; its effective span lies between lengthMs - lengthMs / buckets and
+ * lengthMs. Keys idle for longer than the longest window are dropped by
+ * advance() through a TimingWheel; beyond maxKeys the least recently
+ * updated key is evicted. An evicted key's timer passes to the key that
+ * takes its slot, so the wheel holds at most maxKeys timers.
+ */
+class WindowAggregator
+{
+public:
+    WindowAggregator(std::vector<WindowSpec> windows, size_t maxKeys,
+                     qint64 startMs, qint64 tickMs = 1000);
+
+    const std::vector<WindowSpec>& windows() const { return m_windows; }
+    int windowIndex(const QString& name) const;
+
+    // Events older than a window's current span are ignored by that window
+    void add(const QString& key, double value, qint64 timestampMs);
+
+    // Empty stats for unknown keys
+    WindowStats stats(const QString& key, int window, qint64 nowMs) const;
+
+    // Drops idle keys; call at least once per tick
+    void advance(qint64 nowMs);
+
+    size_t keyCount() const { return m_keys.size(); }
+    size_t maxKeys() const { return m_keys.maxKeys(); }
+    quint64 evictedKeys() const { return m_keys.evictedCount(); }
+    quint64 expiredKeys() const { return m_keys.expiredCount(); }
+    size_t memoryBytes() const;
+
+private:
+    struct Bucket {
+        qint64 index = -1;      // timestamp / bucket width, -1 = empty
+        quint32 count = 0;
+        double sum = 0;
+        double min = 0;
+        double max = 0;
+    };
+
+    Bucket* bucketsOf(quint32 slot) { return &m_buckets[size_t(slot) * m_bucketsPerKey]; }
+    const Bucket* bucketsOf(quint32 slot) const { return &m_buckets[size_t(slot) * m_bucketsPerKey]; }
+
+    std::vector<WindowSpec> m_windows;
+    std::vector<qint64> m_bucketWidthMs;
+    std::vector<size_t> m_bucketOffset;
+    size_t m_bucketsPerKey = 0;
+    BoundedLru m_keys;
+    std::vector<Bucket> m_buckets;      // m_bucketsPerKey per BoundedLru slot
+};
+
+} // namespace rules
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QtGlobal>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rules {
+
+/**
+ * @brief Fixed-size thread pool whose idle workers steal queued tasks
+ *
+ * Each worker owns a deque: it runs its own tasks newest first and, when
+ * that runs dry, takes the oldest task of another worker. Tasks submitted
+ * from outside the pool are spread round-robin; tasks submitted by a
+ * worker stay on its own deque. Tasks run in no particular order, so
+ * callers that need ordering serialize through their own queues (see
+ * ShardedChecker).
+ */
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // threads <= 0: QThread::idealThreadCount()
+    explicit WorkStealingPool(int threads = 0);
+    ~WorkStealingPool();    // runs all queued tasks, then joins
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void submit(Task task);
+
+    int threadCount() const { return static_cast<int>(m_threads.size()); }
+    quint64 stolenCount() const { return m_stolen.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(int index);
+    bool take(int index, Task& task);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+    std::atomic<quint64> m_queued{0};
+    std::atomic<quint64> m_stolen{0};
+    std::atomic<unsigned> m_nextWorker{0};
+
+    // Sleeping workers; submitters only touch the mutex when one waits
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<int> m_sleeping{0};
+    bool m_stopping = false;
+};
+
+} // namespace rules
@@ -11,6 +11,9 @@ Dialog {
     modal: true
     standardButtons: Dialog.Ok | Dialog.Cancel
     
+    // Invalid conditions are rejected by RulesService.createRule
+    onAboutToShow: standardButton(Dialog.Ok).enabled = Qt.binding(function() { return !conditionError.visible })
+    
     anchors.centerIn: parent
     width: Math.min(400, parent.width - 40)
     
@@ -24,6 +27,7 @@ Dialog {
         productField.text = ""
         quantityField.text = "1"
         priceField.text = ""
+        conditionField.text = ""
         customerField.forceActiveFocus()
     }
     
@@ -33,7 +37,8 @@ Dialog {
             productName: productField.text,
             quantity: parseInt(quantityField.text) || 1,
             price: parseFloat(priceField.text) || 0,
-            status: "pending"
+            status: "pending",
+            condition: conditionField.text
         }
     }
     
@@ -77,6 +82,34 @@ Dialog {
             }
         }
         
+        // Condition (optional), e.g. totalAmount > 10000 && customer.tier != "gold"
+        ColumnLayout {
+            Layout.fillWidth: true
+            spacing: 4
+            
+            Label {
+                text: qsTr("Condition")
+                font.pixelSize: 12
+                color: Theme ? Theme.textSecondaryColor : "#757575"
+            }
+            
+            TextField {
+                id: conditionField
+                Layout.fillWidth: true
+                placeholderText: qsTr("e.g. totalAmount > 10000")
+            }
+            
+            Label {
+                id: conditionError
+                Layout.fillWidth: true
+                visible: text.length > 0
+                text: conditionField.text.length > 0 ? RulesService.checkCondition(conditionField.text) : ""
+                font.pixelSize: 12
+                color: "#F44336"
+                wrapMode: Text.Wrap
+            }
+        }
+        
         // Quantity and Price row
         RowLayout {
             Layout.fillWidth: true
@@ -328,6 +328,17 @@ Page {
                             }
                         }
 
+                        MPFButton {
+                            text: qsTr("Send POST CBOR")
+                            type: "secondary"
+                            loading: root.httpLoading
+                            onClicked: {
+                                root.httpLoading = true
+                                root.httpStatusCode = 0
+                                DemoService.testPostCbor(urlField.text, postBodyField.text)
+                            }
+                        }
+
                         Item { width: 8 }
 
                         StatusBadge {
@@ -435,7 +446,7 @@ Page {
                         spacing: 12
                         StatusBadge { status: "info"; text: "Subscribed: demo/rules/**" }
                         Label {
-                            text: qsTr("Messages received: %1").arg(DemoService.receivedMessages.length)
+                            text: qsTr("Messages received: %1").arg(DemoService.messageModel.count)
                             font.pixelSize: 13
                             color: Theme ? Theme.textSecondaryColor : "#757575"
                         }
@@ -589,33 +600,33 @@ Page {
                             anchors.margins: 8
                             clip: true
                             spacing: 4
-                            model: DemoService.receivedMessages
+                            model: DemoService.messageModel
 
                             delegate: RowLayout {
                                 width: ListView.view.width
                                 spacing: 8
 
                                 Label {
-                                    text: modelData.timestamp || ""
+                                    text: model.timestamp || ""
                                     font.pixelSize: 11
                                     font.family: "Consolas"
                                     color: Theme ? Theme.textSecondaryColor : "#9E9E9E"
                                 }
                                 Label {
-                                    text: modelData.topic || ""
+                                    text: model.topic || ""
                                     font.pixelSize: 11
                                     font.family: "Consolas"
                                     color: Theme ? Theme.primaryColor : "#2196F3"
                                 }
                                 Label {
-                                    text: modelData.message || ""
+                                    text: model.message || ""
                                     font.pixelSize: 11
                                     Layout.fillWidth: true
                                     elide: Text.ElideRight
                                     color: Theme ? Theme.textColor : "#212121"
                                 }
                                 Label {
-                                    text: "from: " + (modelData.senderId || "")
+                                    text: "from: " + (model.senderId || "")
                                     font.pixelSize: 11
                                     color: Theme ? Theme.textSecondaryColor : "#9E9E9E"
                                 }
@@ -623,7 +634,7 @@ Page {
 
                             Label {
                                 anchors.centerIn: parent
-                                visible: DemoService.receivedMessages.length === 0
+                                visible: DemoService.messageModel.count === 0
                                 text: qsTr("No messages received yet.\nGo to Orders Demo and send a message!")
                                 font.pixelSize: 12
                                 color: Theme ? Theme.textSecondaryColor : "#9E9E9E"
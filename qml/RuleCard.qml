@@ -71,6 +71,7 @@ Rectangle {
                     color: {
                         switch (root.status) {
                         case "pending": return "#FFF3E0"
+                        case "active": return "#EDE7F6"
                         case "processing": return "#E3F2FD"
                         case "shipped": return "#E8F5E9"
                         case "delivered": return "#E8F5E9"
@@ -88,6 +89,7 @@ Rectangle {
                         color: {
                             switch (root.status) {
                             case "pending": return "#E65100"
+                            case "active": return "#4527A0"
                             case "processing": return "#1565C0"
                             case "shipped": return "#2E7D32"
                             case "delivered": return "#2E7D32"
@@ -137,7 +139,7 @@ Rectangle {
                 // Status change menu
                 ComboBox {
                     id: statusCombo
-                    model: ["pending", "processing", "shipped", "delivered", "cancelled"]
+                    model: ["pending", "active", "processing", "shipped", "delivered", "cancelled"]
                     currentIndex: model.indexOf(root.status)
                     
                     implicitWidth: 130
@@ -16,6 +16,30 @@ Page {
         id: rulesModel
         service: RulesService
     }
+
+    // Revenue is summed on a worker; bursts of edits share one refresh
+    property real totalRevenue: 0
+
+    function refreshRevenue() {
+        RulesService.fetchTotalRevenue(function(total) {
+            root.totalRevenue = total
+        })
+    }
+
+    Component.onCompleted: refreshRevenue()
+
+    Timer {
+        id: revenueRefresh
+        interval: 200
+        onTriggered: root.refreshRevenue()
+    }
+
+    Connections {
+        target: RulesService
+        function onRulesChanged() {
+            revenueRefresh.restart()
+        }
+    }
     
     header: ToolBar {
         background: Rectangle {
@@ -34,12 +58,20 @@ Page {
                 color: Theme ? Theme.textSecondaryColor : "#757575"
             }
 
+            // Rows of a large store are being rebuilt off the UI thread
+            BusyIndicator {
+                running: rulesModel.loading
+                visible: running
+                Layout.preferredWidth: 24
+                Layout.preferredHeight: 24
+            }
+
             Item { Layout.fillWidth: true }
 
             // Status filter
             ComboBox {
                 id: statusFilter
-                model: ["All", "pending", "processing", "shipped", "delivered", "cancelled"]
+                model: ["All", "pending", "active", "processing", "shipped", "delivered", "cancelled"]
                 onCurrentTextChanged: {
                     rulesModel.filterStatus = currentText === "All" ? "" : currentText
                 }
@@ -69,7 +101,7 @@ Page {
         
         StatCard {
             label: qsTr("Active")
-            value: "$" + RulesService.getTotalRevenue().toFixed(2)
+            value: "$" + root.totalRevenue.toFixed(2)
             Layout.fillWidth: true
         }
     }
@@ -189,6 +221,12 @@ Page {
                 Label { text: detailPopup.ruleData.productName || ""; color: Theme ? Theme.textColor : "#212121" }
             }
             
+            RowLayout {
+                visible: !!detailPopup.ruleData.condition
+                Label { text: qsTr("Condition:"); color: Theme ? Theme.textSecondaryColor : "#757575" }
+                Label { text: detailPopup.ruleData.condition || ""; font.family: "monospace"; color: Theme ? Theme.textColor : "#212121" }
+            }
+            
             Item { Layout.fillHeight: true }
             
             RowLayout {
@@ -196,7 +234,7 @@ Page {
                 spacing: 8
                 
                 ComboBox {
-                    model: ["pending", "processing", "shipped", "delivered", "cancelled"]
+                    model: ["pending", "active", "processing", "shipped", "delivered", "cancelled"]
                     currentIndex: model.indexOf(detailPopup.ruleData.status)
                     
                     onActivated: function(index) {
@@ -0,0 +1,162 @@
+#include "bounded_lru.h"
+
+#include <algorithm>
+
+namespace rules {
+
+BoundedLru::BoundedLru(qint64 idleMs, size_t maxKeys, qint64 startMs, qint64 tickMs)
+    : m_idleMs(std::max<qint64>(idleMs, 1))
+    , m_maxKeys(std::max<size_t>(maxKeys, 1))
+    , m_wheel(tickMs, startMs)
+{
+}
+
+quint32 BoundedLru::find(const QString& key) const
+{
+    auto it = m_index.constFind(key);
+    return it != m_index.constEnd() ? it.value() : NONE;
+}
+
+quint32 BoundedLru::use(const QString& key, qint64 nowMs, bool* created)
+{
+    auto it = m_index.constFind(key);
+    if (it != m_index.constEnd()) {
+        if (created) {
+            *created = false;
+        }
+        touch(it.value(), nowMs);
+        return it.value();
+    }
+
+    if (size() >= m_maxKeys && m_tail != NONE) {
+        release(m_tail);
+        ++m_evicted;
+    }
+
+    quint32 slot;
+    if (!m_freeSlots.empty()) {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    } else {
+        slot = static_cast<quint32>(m_slots.size());
+        m_slots.emplace_back();
+    }
+
+    Slot& state = m_slots[slot];
+    state.key = key;
+    state.lastSeenMs = nowMs;
+    state.used = true;
+
+    m_index.insert(key, slot);
+    linkFront(slot);
+    if (!state.armed) {
+        scheduleExpiry(slot);   // else the previous key's timer re-arms for this one
+    }
+    if (created) {
+        *created = true;
+    }
+    return slot;
+}
+
+void BoundedLru::touch(quint32 slot, qint64 nowMs)
+{
+    Slot& state = m_slots[slot];
+    state.lastSeenMs = std::max(state.lastSeenMs, nowMs);
+    moveToFront(slot);  // the pending timer re-arms itself from lastSeenMs
+}
+
+quint32 BoundedLru::remove(const QString& key)
+{
+    const quint32 slot = find(key);
+    if (slot != NONE) {
+        release(slot);
+    }
+    return slot;
+}
+
+std::vector<quint32> BoundedLru::advance(qint64 nowMs)
+{
+    std::vector<quint32> released;
+    for (TimingWheel::TimerId id : m_wheel.advance(nowMs)) {
+        const auto slot = static_cast<quint32>(id);
+        Slot& state = m_slots[slot];
+        state.armed = false;
+        if (!state.used) {
+            continue;  // released since; the slot's next key arms a new timer
+        }
+
+        if (expired(slot, nowMs)) {
+            release(slot);
+            released.push_back(slot);
+            ++m_expired;
+        } else {
+            scheduleExpiry(slot);  // used since (or recycled): re-arm instead of one timer per use
+        }
+    }
+    return released;
+}
+
+size_t BoundedLru::memoryBytes() const
+{
+    return m_slots.capacity() * sizeof(Slot)
+         + m_freeSlots.capacity() * sizeof(quint32)
+         + static_cast<size_t>(m_index.capacity()) * (sizeof(QString) + sizeof(quint32) + sizeof(size_t));
+}
+
+void BoundedLru::release(quint32 slot)
+{
+    Slot& state = m_slots[slot];
+    unlink(slot);
+    m_index.remove(state.key);
+    state.key = QString();
+    state.used = false;  // a pending timer stays armed and is dropped when it fires
+    m_freeSlots.push_back(slot);
+}
+
+void BoundedLru::linkFront(quint32 slot)
+{
+    Slot& state = m_slots[slot];
+    state.prev = NONE;
+    state.next = m_head;
+    if (m_head != NONE) {
+        m_slots[m_head].prev = slot;
+    }
+    m_head = slot;
+    if (m_tail == NONE) {
+        m_tail = slot;
+    }
+}
+
+void BoundedLru::unlink(quint32 slot)
+{
+    Slot& state = m_slots[slot];
+    if (state.prev != NONE) {
+        m_slots[state.prev].next = state.next;
+    } else {
+        m_head = state.next;
+    }
+    if (state.next != NONE) {
+        m_slots[state.next].prev = state.prev;
+    } else {
+        m_tail = state.prev;
+    }
+    state.prev = NONE;
+    state.next = NONE;
+}
+
+void BoundedLru::moveToFront(quint32 slot)
+{
+    if (m_head != slot) {
+        unlink(slot);
+        linkFront(slot);
+    }
+}
+
+void BoundedLru::scheduleExpiry(quint32 slot)
+{
+    Slot& state = m_slots[slot];
+    state.armed = true;
+    m_wheel.schedule(slot, state.lastSeenMs + m_idleMs);
+}
+
+} // namespace rules
@@ -0,0 +1,60 @@
+#include "correlation_store.h"
+
+namespace rules {
+
+CorrelationStore::CorrelationStore(qint64 ttlMs, size_t maxEntries, qint64 startMs, qint64 tickMs)
+    : m_keys(ttlMs, maxEntries, startMs, tickMs)
+{
+}
+
+void CorrelationStore::put(const QString& orderId, const OrderProjection& projection, qint64 nowMs)
+{
+    const quint32 slot = m_keys.use(orderId, nowMs);
+    if (slot >= m_projections.size()) {
+        m_projections.resize(m_keys.slotCount());
+    }
+    m_projections[slot] = projection;
+}
+
+const OrderProjection* CorrelationStore::find(const QString& orderId, qint64 nowMs) const
+{
+    // Due entries stay in the table until the next advance()
+    const quint32 slot = m_keys.find(orderId);
+    return slot != BoundedLru::NONE && !m_keys.expired(slot, nowMs) ? &m_projections[slot] : nullptr;
+}
+
+OrderProjection* CorrelationStore::touch(const QString& orderId, qint64 nowMs)
+{
+    const quint32 slot = m_keys.find(orderId);
+    if (slot == BoundedLru::NONE || m_keys.expired(slot, nowMs)) {
+        return nullptr;
+    }
+    m_keys.touch(slot, nowMs);
+    return &m_projections[slot];
+}
+
+bool CorrelationStore::remove(const QString& orderId)
+{
+    const quint32 slot = m_keys.remove(orderId);
+    if (slot == BoundedLru::NONE) {
+        return false;
+    }
+    m_projections[slot] = OrderProjection();
+    return true;
+}
+
+void CorrelationStore::advance(qint64 nowMs)
+{
+    // Drop the released projections' references to the events' strings
+    for (quint32 slot : m_keys.advance(nowMs)) {
+        m_projections[slot] = OrderProjection();
+    }
+}
+
+size_t CorrelationStore::memoryBytes() const
+{
+    // Excludes string data, which is shared with the original events
+    return m_keys.memoryBytes() + m_projections.capacity() * sizeof(OrderProjection);
+}
+
+} // namespace rules
@@ -1,9 +1,14 @@
 #include "demo_service.h"
+#include "payload_codec.h"
+#include "outbound_http.h"
+#include "event_recorder.h"
+#include "event_message_model.h"
+#include "plugin_log.h"
+#include "rules_metrics.h"
+#include "trace.h"
 #include <mpf/http/http_client.h>
-#include <mpf/logger.h>
 
-#include <QJsonDocument>
-#include <QJsonObject>
+#include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QDateTime>
 
@@ -13,7 +18,10 @@ DemoService::DemoService(const QString& pluginId, QObject* parent)
     : QObject(parent)
     , m_pluginId(pluginId)
 {
+    RULES_TRACE_SCOPE("DemoService::DemoService");
     m_httpClient = std::make_unique<mpf::http::HttpClient>(this);
+    m_outbound = std::make_unique<OutboundHttp>(this);
+    m_messages = new EventMessageModel(MAX_MESSAGES, this);
 }
 
 DemoService::~DemoService() = default;
@@ -24,60 +32,92 @@ DemoService::~DemoService() = default;
 
 void DemoService::testGet(const QString& url)
 {
-    MPF_LOG_INFO("DemoService", QString("GET %1").arg(url).toStdString().c_str());
+    RULES_LOG_INFO("DemoService", "GET %1", url);
 
     m_requestTimer.start();
 
-    auto* reply = m_httpClient->get(QUrl(url));
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        int elapsed = static_cast<int>(m_requestTimer.elapsed());
-        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-        bool success = (reply->error() == QNetworkReply::NoError);
-        QString body;
-
-        if (success) {
-            body = QString::fromUtf8(reply->readAll());
-        } else {
-            body = QString("Error: %1\n%2").arg(reply->errorString(), QString::fromUtf8(reply->readAll()));
-        }
-
-        emit httpResponseReceived(success, statusCode, body, elapsed);
-        reply->deleteLater();
-    });
+    // GETs are idempotent, so they may be hedged against slow replicas
+    m_outbound->submit([this, url]() { return m_httpClient->get(QUrl(url)); },
+                       [this](QNetworkReply* reply) { handleReply(reply); },
+                       true);
 }
 
 void DemoService::testPost(const QString& url, const QString& jsonBody)
 {
-    MPF_LOG_INFO("DemoService", QString("POST %1").arg(url).toStdString().c_str());
+    RULES_LOG_INFO("DemoService", "POST %1", url);
 
     m_requestTimer.start();
 
-    // Parse JSON body
-    QJsonParseError parseError;
-    QJsonDocument doc = QJsonDocument::fromJson(jsonBody.toUtf8(), &parseError);
+    // Parse the JSON body on a worker; only the send happens on this thread
+    PayloadCodec::encode(jsonBody, PayloadFormat::Json)
+        .then(this, [this, url](EncodedPayload payload) {
+            if (!payload.ok) {
+                emit httpResponseReceived(false, 0, payload.error, 0);
+                return;
+            }
+            QJsonObject json = payload.json;
+            m_outbound->submit([this, url, json]() { return m_httpClient->postJson(QUrl(url), json); },
+                               [this](QNetworkReply* reply) { handleReply(reply); },
+                               false);
+        });
+}
+
+void DemoService::testPostCbor(const QString& url, const QString& jsonBody)
+{
+    RULES_LOG_INFO("DemoService", "POST (CBOR) %1", url);
+
+    m_requestTimer.start();
 
-    if (parseError.error != QJsonParseError::NoError) {
-        emit httpResponseReceived(false, 0,
-            QString("JSON parse error: %1").arg(parseError.errorString()), 0);
+    PayloadCodec::encode(jsonBody, PayloadFormat::Cbor)
+        .then(this, [this, url](EncodedPayload payload) {
+            if (!payload.ok) {
+                emit httpResponseReceived(false, 0, payload.error, 0);
+                return;
+            }
+
+            if (!m_rawNetwork) {
+                m_rawNetwork = new QNetworkAccessManager(this);
+            }
+
+            const QString contentType = PayloadCodec::contentType(PayloadFormat::Cbor);
+            QNetworkRequest request{QUrl(url)};
+            request.setHeader(QNetworkRequest::ContentTypeHeader, contentType);
+            request.setRawHeader("Accept", contentType.toUtf8() + ", application/json;q=0.9");
+            QByteArray bytes = payload.bytes;
+            m_outbound->submit([this, request, bytes]() { return m_rawNetwork->post(request, bytes); },
+                               [this](QNetworkReply* reply) { handleReply(reply); },
+                               false);
+        });
+}
+
+QVariantMap DemoService::httpStats() const
+{
+    return m_outbound->stats();
+}
+
+void DemoService::handleReply(QNetworkReply* reply)
+{
+    // Called once the winning attempt finished; OutboundHttp deletes the reply
+    int elapsed = static_cast<int>(m_requestTimer.elapsed());
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    bool success = (reply->error() == QNetworkReply::NoError);
+    QByteArray body = reply->readAll();
+
+    if (!success) {
+        QString error = QString("Error: %1\n%2").arg(reply->errorString(), QString::fromUtf8(body));
+        emit httpResponseReceived(false, statusCode, error, elapsed);
         return;
     }
 
-    auto* reply = m_httpClient->postJson(QUrl(url), doc.object());
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        int elapsed = static_cast<int>(m_requestTimer.elapsed());
-        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-        bool success = (reply->error() == QNetworkReply::NoError);
-        QString body;
-
-        if (success) {
-            body = QString::fromUtf8(reply->readAll());
-        } else {
-            body = QString("Error: %1\n%2").arg(reply->errorString(), QString::fromUtf8(reply->readAll()));
-        }
-
-        emit httpResponseReceived(success, statusCode, body, elapsed);
-        reply->deleteLater();
-    });
+    // Decode (and build the display text) off the GUI thread
+    const QString contentType = reply->header(QNetworkRequest::ContentTypeHeader).toString();
+    PayloadCodec::decode(body, contentType)
+        .then(this, [this, statusCode, elapsed](DecodedPayload decoded) {
+            emit httpResponseReceived(true, statusCode, decoded.text, elapsed);
+            if (decoded.ok) {
+                emit httpResponseParsed(statusCode, decoded.value, elapsed);
+            }
+        });
 }
 
 // =============================================================================
@@ -86,30 +126,56 @@ void DemoService::testPost(const QString& url, const QString& jsonBody)
 
 QVariantList DemoService::receivedMessages() const
 {
-    return m_receivedMessages;
+    return m_messages->toVariantList();
 }
 
 void DemoService::clearMessages()
 {
-    m_receivedMessages.clear();
+    m_messages->clear();
+    metrics::gauge(RulesMetrics::counters().messageQueueDepth, 0);
     emit messagesChanged();
 }
 
+QAbstractItemModel* DemoService::messageModel() const
+{
+    return m_messages;
+}
+
 int DemoService::messageCount() const
 {
-    return m_receivedMessages.size();
+    return m_messages->rowCount();
+}
+
+bool DemoService::startRecording(const QString& path)
+{
+    auto recorder = std::make_unique<EventRecorder>(path);
+    if (!recorder->isOpen()) {
+        RULES_LOG_WARNING("DemoService", "Cannot record events to %1", path);
+        return false;
+    }
+
+    m_recorder = std::move(recorder);
+    RULES_LOG_INFO("DemoService", "Recording events to %1", path);
+    return true;
+}
+
+void DemoService::stopRecording()
+{
+    if (!m_recorder) {
+        return;
+    }
+
+    RULES_LOG_INFO("DemoService", "Recorded %1 events to %2",
+                   m_recorder->eventCount(), m_recorder->path());
+    m_recorder.reset();
 }
 
 void DemoService::connectToEventBus(QObject* eventBusObj, const QString& topicPrefix)
 {
     m_topicPrefix = topicPrefix;
 
-    // Use old-style connect for cross-DLL safety
-    // EventBusService emits: eventPublished(QString, QVariantMap, QString)
-    connect(eventBusObj, SIGNAL(eventPublished(QString,QVariantMap,QString)),
-            this, SLOT(onEventReceived(QString,QVariantMap,QString)));
-
-    // Also register a pattern subscription so the EventBus emits the signal
+    // Events arrive through EventScheduler (see RulesPlugin::connectServices);
+    // the pattern subscription is what makes the EventBus emit them at all
     // (deliverEvent skips signal emission when no pattern subscribers match)
     QString pattern = topicPrefix + "**";
     QString subId;
@@ -118,42 +184,48 @@ void DemoService::connectToEventBus(QObject* eventBusObj, const QString& topicPr
         Q_ARG(QString, pattern),
         Q_ARG(QString, m_pluginId + ".demo"));
 
-    MPF_LOG_INFO("DemoService",
-        QString("Connected to EventBus, filtering: %1").arg(topicPrefix).toStdString().c_str());
+    RULES_LOG_INFO("DemoService", "Connected to EventBus, filtering: %1", topicPrefix);
+}
+
+void DemoService::recordEvent(const QString& topic, const QVariantMap& data,
+                              const QString& senderId)
+{
+    if (m_recorder) {
+        m_recorder->record(topic, data, senderId);
+    }
 }
 
 void DemoService::onEventReceived(const QString& topic, const QVariantMap& data,
                                    const QString& senderId)
 {
+    RULES_TRACE_SCOPE("DemoService::onEventReceived");
+
+    MetricCounters& counters = RulesMetrics::counters();
+    metrics::count(counters.eventsReceived);
+
     // Filter by topic prefix
     if (!topic.startsWith(m_topicPrefix)) {
+        metrics::count(counters.eventsFiltered);
         return;
     }
 
     // Don't receive our own events
     if (senderId == m_pluginId) {
+        metrics::count(counters.eventsFiltered);
         return;
     }
 
-    QVariantMap msg;
-    msg["topic"] = topic;
-    msg["data"] = data;
-    msg["senderId"] = senderId;
-    msg["timestamp"] = QDateTime::currentDateTime().toString("hh:mm:ss.zzz");
-    msg["message"] = data.value("message", "").toString();
-
-    // Prepend (newest first)
-    m_receivedMessages.prepend(msg);
-
-    // Cap at MAX_MESSAGES
-    while (m_receivedMessages.size() > MAX_MESSAGES) {
-        m_receivedMessages.removeLast();
+    // Typed record, newest first; the oldest is evicted beyond MAX_MESSAGES.
+    // Display strings are only built when a view asks for a row.
+    if (m_messages->append(topic, senderId, QDateTime::currentMSecsSinceEpoch(), data)) {
+        metrics::count(counters.eventsDropped);
     }
+    metrics::gauge(counters.messageQueueDepth, m_messages->rowCount());
 
     emit messagesChanged();
 
-    MPF_LOG_DEBUG("DemoService",
-        QString("Received event: %1 from %2").arg(topic, senderId).toStdString().c_str());
+    RULES_LOG_RATE_LIMITED(log::Level::Debug, 100, "DemoService",
+                           "Received event: %1 from %2", topic, senderId);
 }
 
 } // namespace rules
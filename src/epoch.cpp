@@ -0,0 +1,170 @@
+#include "epoch.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace rules::epoch {
+
+namespace {
+
+struct alignas(64) Slot {
+    std::atomic<quint64> pinned{0};     // 0 = not inside a guard
+    std::atomic<bool> claimed{false};
+};
+
+struct Retired {
+    void* object;
+    void (*destroy)(void*);
+    quint64 epoch;
+};
+
+std::atomic<quint64> g_epoch{1};
+std::array<Slot, MAX_THREADS> g_slots;
+
+std::mutex g_retiredMutex;
+std::vector<Retired> g_retired;
+
+// Pins of threads that found every slot taken
+std::mutex g_overflowMutex;
+std::multiset<quint64> g_overflowPins;
+
+struct ThreadRecord {
+    static constexpr int OVERFLOW_SLOT = -2;
+
+    int slot = -1;
+    int depth = 0;
+    quint64 overflowPin = 0;
+
+    ~ThreadRecord()
+    {
+        if (slot >= 0) {
+            g_slots[static_cast<size_t>(slot)].pinned.store(0);
+            g_slots[static_cast<size_t>(slot)].claimed.store(false);
+        }
+    }
+
+    void pin()
+    {
+        if (slot == -1) {
+            claim();
+        }
+        if (slot == OVERFLOW_SLOT) {
+            std::lock_guard<std::mutex> lock(g_overflowMutex);
+            overflowPin = g_epoch.load();
+            g_overflowPins.insert(overflowPin);
+            return;
+        }
+        g_slots[static_cast<size_t>(slot)].pinned.store(g_epoch.load());
+    }
+
+    void unpin()
+    {
+        if (slot == OVERFLOW_SLOT) {
+            std::lock_guard<std::mutex> lock(g_overflowMutex);
+            g_overflowPins.erase(g_overflowPins.find(overflowPin));
+            return;
+        }
+        g_slots[static_cast<size_t>(slot)].pinned.store(0);
+    }
+
+    void claim()
+    {
+        for (int i = 0; i < MAX_THREADS; ++i) {
+            bool expected = false;
+            if (g_slots[static_cast<size_t>(i)].claimed.compare_exchange_strong(expected, true)) {
+                slot = i;
+                return;
+            }
+        }
+        slot = OVERFLOW_SLOT;
+    }
+};
+
+ThreadRecord& threadRecord()
+{
+    thread_local ThreadRecord record;
+    return record;
+}
+
+} // namespace
+
+// All accesses are sequentially consistent: a reader's pin is ordered
+// before its pointer load, a writer's unpublish before its epoch bump,
+// so a scan that misses a pin can only miss readers of the new object.
+
+Guard::Guard()
+{
+    ThreadRecord& record = threadRecord();
+    if (record.depth++ == 0) {
+        record.pin();
+    }
+}
+
+Guard::~Guard()
+{
+    ThreadRecord& record = threadRecord();
+    if (--record.depth == 0) {
+        record.unpin();
+    }
+}
+
+void retire(void* object, void (*destroy)(void*))
+{
+    const quint64 epoch = g_epoch.fetch_add(1);
+    std::lock_guard<std::mutex> lock(g_retiredMutex);
+    g_retired.push_back({object, destroy, epoch});
+}
+
+size_t collect()
+{
+    // Take the candidates before scanning: each was retired (epoch bumped)
+    // before the scan, so any reader that could still hold one is pinned
+    // at or below its epoch by the time the scan looks
+    std::vector<Retired> candidates;
+    {
+        std::lock_guard<std::mutex> lock(g_retiredMutex);
+        candidates.swap(g_retired);
+    }
+    if (candidates.empty()) {
+        return 0;
+    }
+
+    quint64 oldestPinned = std::numeric_limits<quint64>::max();
+    for (const Slot& slot : g_slots) {
+        const quint64 pinned = slot.pinned.load();
+        if (pinned != 0 && pinned < oldestPinned) {
+            oldestPinned = pinned;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_overflowMutex);
+        if (!g_overflowPins.empty()) {
+            oldestPinned = std::min(oldestPinned, *g_overflowPins.begin());
+        }
+    }
+
+    auto keep = std::partition(candidates.begin(), candidates.end(),
+        [oldestPinned](const Retired& retired) { return retired.epoch >= oldestPinned; });
+    if (keep != candidates.begin()) {
+        std::lock_guard<std::mutex> lock(g_retiredMutex);
+        g_retired.insert(g_retired.end(), candidates.begin(), keep);
+    }
+
+    for (auto it = keep; it != candidates.end(); ++it) {
+        it->destroy(it->object);
+    }
+    return static_cast<size_t>(candidates.end() - keep);
+}
+
+size_t pendingCount()
+{
+    std::lock_guard<std::mutex> lock(g_retiredMutex);
+    return g_retired.size();
+}
+
+} // namespace rules::epoch
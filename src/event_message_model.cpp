@@ -0,0 +1,154 @@
+#include "event_message_model.h"
+
+#include <QDateTime>
+
+namespace rules {
+
+EventMessageModel::EventMessageModel(int capacity, QObject* parent)
+    : QAbstractListModel(parent)
+    , m_ring(static_cast<size_t>(capacity))
+{
+}
+
+EventMessageModel::~EventMessageModel() = default;
+
+bool EventMessageModel::append(const QString& topic, const QString& senderId, qint64 epochMs,
+                               const QVariantMap& payload)
+{
+    const int capacity = static_cast<int>(m_ring.size());
+    const bool evict = m_count == capacity;
+
+    if (evict) {
+        beginRemoveRows(QModelIndex(), m_count - 1, m_count - 1);
+        --m_count;
+        endRemoveRows();
+    }
+
+    if (m_strings.size() >= MAX_STRINGS) {
+        compactStrings();
+    }
+
+    beginInsertRows(QModelIndex(), 0, 0);
+    EventRecord& record = m_ring[static_cast<size_t>(m_head)];
+    record.topic = intern(topic);
+    record.sender = intern(senderId);
+    record.epochMs = epochMs;
+    record.payload = payload;
+    m_head = (m_head + 1) % capacity;
+    ++m_count;
+    endInsertRows();
+
+    emit countChanged();
+    return evict;
+}
+
+void EventMessageModel::clear()
+{
+    beginResetModel();
+    for (EventRecord& record : m_ring) {
+        record.payload = {};
+    }
+    m_head = 0;
+    m_count = 0;
+    m_stringIds.clear();
+    m_strings.clear();
+    endResetModel();
+    emit countChanged();
+}
+
+QVariantList EventMessageModel::toVariantList() const
+{
+    QVariantList result;
+    result.reserve(m_count);
+    for (int row = 0; row < m_count; ++row) {
+        const EventRecord& record = recordAt(row);
+        result.append(QVariantMap{
+            {"topic", m_strings.at(record.topic)},
+            {"data", record.payload},
+            {"senderId", m_strings.at(record.sender)},
+            {"timestamp", QDateTime::fromMSecsSinceEpoch(record.epochMs).toString("hh:mm:ss.zzz")},
+            {"message", record.payload.value("message").toString()}
+        });
+    }
+    return result;
+}
+
+int EventMessageModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return 0;
+    return m_count;
+}
+
+QVariant EventMessageModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_count) {
+        return QVariant();
+    }
+
+    const EventRecord& record = recordAt(index.row());
+
+    switch (role) {
+    case TopicRole:
+        return m_strings.at(record.topic);
+    case SenderIdRole:
+        return m_strings.at(record.sender);
+    case TimestampRole:
+        return QDateTime::fromMSecsSinceEpoch(record.epochMs).toString("hh:mm:ss.zzz");
+    case MessageRole:
+        return record.payload.value("message").toString();
+    case DataRole:
+        return record.payload;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> EventMessageModel::roleNames() const
+{
+    return {
+        {TopicRole, "topic"},
+        {SenderIdRole, "senderId"},
+        {TimestampRole, "timestamp"},
+        {MessageRole, "message"},
+        {DataRole, "data"}
+    };
+}
+
+size_t EventMessageModel::slotAt(int row) const
+{
+    const int capacity = static_cast<int>(m_ring.size());
+    return static_cast<size_t>((m_head - 1 - row + 2 * capacity) % capacity);
+}
+
+const EventRecord& EventMessageModel::recordAt(int row) const
+{
+    return m_ring[slotAt(row)];
+}
+
+quint16 EventMessageModel::intern(const QString& value)
+{
+    auto it = m_stringIds.constFind(value);
+    if (it != m_stringIds.constEnd()) {
+        return it.value();
+    }
+
+    const auto id = static_cast<quint16>(m_strings.size());
+    m_strings.append(value);
+    m_stringIds.insert(value, id);
+    return id;
+}
+
+void EventMessageModel::compactStrings()
+{
+    const QStringList old = m_strings;
+    m_strings.clear();
+    m_stringIds.clear();
+
+    for (int row = 0; row < m_count; ++row) {
+        EventRecord& record = m_ring[slotAt(row)];
+        record.topic = intern(old.at(record.topic));
+        record.sender = intern(old.at(record.sender));
+    }
+}
+
+} // namespace rules
@@ -0,0 +1,135 @@
+#include "event_recorder.h"
+
+namespace rules {
+
+namespace {
+
+constexpr quint32 LOG_MAGIC = 0x524C4556;  // "RLEV"
+constexpr quint16 LOG_VERSION = 1;
+constexpr quint16 MAX_STRINGS = 0xFFFF;
+
+enum RecordKind : quint8 {
+    StringDefinition = 0,
+    Event = 1
+};
+
+} // namespace
+
+// =============================================================================
+// EventRecorder
+// =============================================================================
+
+EventRecorder::EventRecorder(const QString& path)
+    : m_file(path)
+{
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return;
+    }
+
+    m_out.setDevice(&m_file);
+    m_out.setVersion(QDataStream::Qt_6_0);
+    m_out << LOG_MAGIC << LOG_VERSION;
+    m_clock.start();
+}
+
+EventRecorder::~EventRecorder()
+{
+    flush();
+}
+
+void EventRecorder::record(const QString& topic, const QVariantMap& data, const QString& senderId)
+{
+    if (!isOpen()) {
+        return;
+    }
+
+    const qint64 offsetNs = m_clock.nsecsElapsed();
+    const quint16 topicIndex = intern(topic);
+    const quint16 senderIndex = intern(senderId);
+    if (topicIndex == MAX_STRINGS || senderIndex == MAX_STRINGS) {
+        return;  // string table full
+    }
+
+    m_out << quint8(Event) << offsetNs << topicIndex << senderIndex << data;
+    ++m_eventCount;
+}
+
+void EventRecorder::flush()
+{
+    if (isOpen()) {
+        m_file.flush();
+    }
+}
+
+quint16 EventRecorder::intern(const QString& value)
+{
+    auto it = m_strings.constFind(value);
+    if (it != m_strings.constEnd()) {
+        return it.value();
+    }
+
+    if (m_strings.size() >= MAX_STRINGS) {
+        return MAX_STRINGS;
+    }
+
+    const auto index = static_cast<quint16>(m_strings.size());
+    m_strings.insert(value, index);
+    m_out << quint8(StringDefinition) << index << value;
+    return index;
+}
+
+// =============================================================================
+// EventLogReader
+// =============================================================================
+
+EventLogReader::EventLogReader(const QString& path)
+    : m_file(path)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    m_in.setDevice(&m_file);
+    m_in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    m_in >> magic >> version;
+    m_valid = magic == LOG_MAGIC && version == LOG_VERSION;
+}
+
+bool EventLogReader::next(RecordedEvent& event)
+{
+    while (m_valid && !m_in.atEnd()) {
+        quint8 kind = 0;
+        m_in >> kind;
+
+        if (kind == StringDefinition) {
+            quint16 index = 0;
+            QString value;
+            m_in >> index >> value;
+            if (index != m_strings.size()) {
+                m_valid = false;
+                break;
+            }
+            m_strings.append(value);
+            continue;
+        }
+
+        quint16 topicIndex = 0;
+        quint16 senderIndex = 0;
+        m_in >> event.offsetNs >> topicIndex >> senderIndex >> event.data;
+        if (kind != Event || m_in.status() != QDataStream::Ok
+            || topicIndex >= m_strings.size() || senderIndex >= m_strings.size()) {
+            m_valid = false;
+            break;
+        }
+
+        event.topic = m_strings.at(topicIndex);
+        event.senderId = m_strings.at(senderIndex);
+        return true;
+    }
+    return false;
+}
+
+} // namespace rules
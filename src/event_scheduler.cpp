@@ -0,0 +1,230 @@
+#include "event_scheduler.h"
+#include "plugin_log.h"
+#include "rules_metrics.h"
+#include "trace.h"
+
+#include <mpf/interfaces/ieventbus.h>
+
+#include <QTimer>
+#include <algorithm>
+
+namespace rules {
+
+EventScheduler::EventScheduler(const QString& pluginId, QObject* parent)
+    : QObject(parent)
+    , m_pluginId(pluginId)
+{
+    m_clock.start();
+}
+
+EventScheduler::~EventScheduler() = default;
+
+void EventScheduler::addClass(const PriorityClass& spec)
+{
+    Queue queue;
+    queue.spec = spec;
+    queue.spec.capacity = qMax(1, spec.capacity);
+    queue.spec.sampleEvery = qMax(1, spec.sampleEvery);
+
+    // Stable by priority, so equal priorities keep registration order
+    auto pos = std::upper_bound(m_queues.begin(), m_queues.end(), spec.priority,
+        [](int priority, const Queue& q) { return priority < q.spec.priority; });
+    m_capacity += queue.spec.capacity;
+    m_queues.insert(pos, std::move(queue));
+}
+
+void EventScheduler::connectToEventBus(mpf::IEventBus* eventBus)
+{
+    auto* eventBusObj = dynamic_cast<QObject*>(eventBus);
+    if (!eventBusObj) {
+        return;
+    }
+    m_eventBus = eventBus;
+
+    // Old-style connect for cross-DLL safety, as everywhere else
+    connect(eventBusObj, SIGNAL(eventPublished(QString,QVariantMap,QString)),
+            this, SLOT(submit(QString,QVariantMap,QString)));
+
+    RULES_LOG_INFO("EventScheduler", "Scheduling %1 priority classes, %2 events capacity",
+                   static_cast<int>(m_queues.size()), m_capacity);
+}
+
+QVariantMap EventScheduler::stats() const
+{
+    QVariantMap result;
+    for (const Queue& queue : m_queues) {
+        result.insert(queue.spec.name, QVariantMap{
+            {"queued", static_cast<int>(queue.events.size())},
+            {"admitted", queue.admitted},
+            {"dispatched", queue.dispatched},
+            {"shed", queue.shed},
+            {"expired", queue.expired}
+        });
+    }
+    return result;
+}
+
+// =============================================================================
+// Admission
+// =============================================================================
+
+bool EventScheduler::submit(const QString& topic, const QVariantMap& data,
+                            const QString& senderId)
+{
+    emit eventArrived(topic, data, senderId);
+
+    Queue* queue = classify(topic);
+    if (!queue) {
+        return false;
+    }
+
+    ++queue->arrivals;
+    if (!makeRoom(*queue)) {
+        ++queue->shed;
+        metrics::count(RulesMetrics::counters().eventsShed);
+        RULES_LOG_RATE_LIMITED(log::Level::Warning, 1, "EventScheduler",
+                               "Shedding %1 events: class %2 full (%3 queued)",
+                               topic, queue->spec.name, m_queued);
+        return false;
+    }
+
+    queue->events.push_back({topic, data, senderId, m_clock.nsecsElapsed()});
+    ++queue->admitted;
+    ++m_queued;
+    metrics::gauge(RulesMetrics::counters().eventsQueued, m_queued);
+    updateBackpressure();
+
+    if (!m_dispatchPending) {
+        m_dispatchPending = true;
+        QTimer::singleShot(0, this, &EventScheduler::dispatch);
+    }
+    return true;
+}
+
+EventScheduler::Queue* EventScheduler::classify(const QString& topic)
+{
+    for (Queue& queue : m_queues) {
+        for (const QString& pattern : std::as_const(queue.spec.topics)) {
+            if (pattern.endsWith(QLatin1Char('/')) ? topic.startsWith(pattern) : topic == pattern) {
+                return &queue;
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool EventScheduler::makeRoom(Queue& queue)
+{
+    const auto size = static_cast<int>(queue.events.size());
+    const PriorityClass& spec = queue.spec;
+
+    switch (spec.policy) {
+    case ShedPolicy::DropOldest:
+        if (size >= spec.capacity) {
+            shedOldest(queue);
+        }
+        return true;
+
+    case ShedPolicy::DropLowestPriority:
+        if (size < spec.capacity) {
+            return true;
+        }
+        // Borrow a slot from the least important class queued below us
+        for (auto it = m_queues.rbegin(); it != m_queues.rend() && &*it != &queue; ++it) {
+            if (!it->events.empty() && it->spec.priority > spec.priority) {
+                shedOldest(*it);
+                return true;
+            }
+        }
+        return false;
+
+    case ShedPolicy::Sample:
+        if (size >= spec.capacity) {
+            return false;
+        }
+        return size * 2 < spec.capacity || queue.arrivals % static_cast<quint64>(spec.sampleEvery) == 0;
+    }
+    return false;
+}
+
+void EventScheduler::shedOldest(Queue& queue)
+{
+    queue.events.pop_front();
+    --m_queued;
+    ++queue.shed;
+    metrics::count(RulesMetrics::counters().eventsShed);
+    RULES_LOG_RATE_LIMITED(log::Level::Warning, 1, "EventScheduler",
+                           "Shedding queued %1 events (%2 queued)", queue.spec.name, m_queued);
+}
+
+// =============================================================================
+// Dispatch
+// =============================================================================
+
+void EventScheduler::dispatch()
+{
+    RULES_TRACE_SCOPE("EventScheduler::dispatch");
+    m_dispatchPending = false;
+
+    QElapsedTimer slice;
+    slice.start();
+    MetricCounters& counters = RulesMetrics::counters();
+
+    while (m_queued > 0 && slice.elapsed() < m_sliceMs) {
+        auto queue = std::find_if(m_queues.begin(), m_queues.end(),
+                                  [](const Queue& q) { return !q.events.empty(); });
+        Event event = std::move(queue->events.front());
+        queue->events.pop_front();
+        --m_queued;
+
+        const qint64 deadlineNs = queue->spec.deadlineMs * 1000000;
+        if (deadlineNs > 0 && m_clock.nsecsElapsed() - event.enqueuedNs > deadlineNs) {
+            ++queue->expired;
+            metrics::count(counters.eventsExpired);
+            continue;
+        }
+
+        ++queue->dispatched;
+        // Handlers may publish, re-entering submit(); nothing here is held
+        // across the emission
+        emit eventDispatched(event.topic, event.data, event.senderId);
+    }
+
+    metrics::gauge(counters.eventsQueued, m_queued);
+    updateBackpressure();
+
+    // Yield to the event loop between slices
+    if (m_queued > 0 && !m_dispatchPending) {
+        m_dispatchPending = true;
+        QTimer::singleShot(0, this, &EventScheduler::dispatch);
+    }
+}
+
+void EventScheduler::updateBackpressure()
+{
+    const bool active = m_backpressure
+        ? m_queued * 2 > m_capacity         // release below 50%
+        : m_queued * 5 >= m_capacity * 4;   // engage at 80%
+    if (active == m_backpressure) {
+        return;
+    }
+    m_backpressure = active;
+
+    quint64 shed = 0;
+    for (const Queue& queue : m_queues) {
+        shed += queue.shed + queue.expired;
+    }
+    RULES_LOG_INFO("EventScheduler", "Backpressure %1: %2 of %3 queued, %4 shed so far",
+                   active ? QStringLiteral("on") : QStringLiteral("off"), m_queued, m_capacity, shed);
+
+    if (m_eventBus) {
+        m_eventBus->publish("rules/backpressure", {
+            {"active", active},
+            {"queued", m_queued},
+            {"capacity", m_capacity},
+            {"shed", shed}
+        }, m_pluginId);
+    }
+}
+
+} // namespace rules
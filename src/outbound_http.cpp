@@ -0,0 +1,208 @@
+#include "outbound_http.h"
+#include "rules_metrics.h"
+
+#include <QNetworkReply>
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+
+namespace rules {
+
+// =============================================================================
+// LatencyTracker
+// =============================================================================
+
+LatencyTracker::LatencyTracker(int capacity)
+    : m_samples(static_cast<size_t>(capacity), 0)
+{
+}
+
+void LatencyTracker::add(qint64 latencyMs)
+{
+    m_samples[static_cast<size_t>(m_next)] = latencyMs;
+    m_next = (m_next + 1) % static_cast<int>(m_samples.size());
+    m_count = std::min(m_count + 1, static_cast<int>(m_samples.size()));
+}
+
+qint64 LatencyTracker::percentile(double p) const
+{
+    if (m_count == 0) {
+        return -1;
+    }
+
+    std::vector<qint64> sorted(m_samples.begin(), m_samples.begin() + m_count);
+    auto rank = static_cast<size_t>(std::ceil(p * m_count));
+    auto nth = sorted.begin() + static_cast<std::ptrdiff_t>(std::clamp<size_t>(rank, 1, sorted.size()) - 1);
+    std::nth_element(sorted.begin(), nth, sorted.end());
+    return *nth;
+}
+
+// =============================================================================
+// ConcurrencyLimiter
+// =============================================================================
+
+ConcurrencyLimiter::ConcurrencyLimiter(int initialLimit, int minLimit, int maxLimit)
+    : m_limit(initialLimit)
+    , m_minLimit(minLimit)
+    , m_maxLimit(maxLimit)
+{
+}
+
+bool ConcurrencyLimiter::tryAcquire()
+{
+    if (m_inFlight >= limit()) {
+        return false;
+    }
+    ++m_inFlight;
+    return true;
+}
+
+void ConcurrencyLimiter::release(qint64 latencyMs, Outcome outcome)
+{
+    m_inFlight = std::max(0, m_inFlight - 1);
+
+    if (outcome == Outcome::Ignored) {
+        return;
+    }
+
+    const double latency = static_cast<double>(latencyMs);
+    if (outcome == Outcome::Success) {
+        if (m_baselineMs < 0 || latency < m_baselineMs) {
+            m_baselineMs = latency;
+        } else {
+            m_baselineMs += (latency - m_baselineMs) * 0.01;
+        }
+    }
+
+    const bool congested = outcome == Outcome::Dropped
+        || latency > LATENCY_TOLERANCE * std::max(m_baselineMs, 1.0);
+
+    if (congested) {
+        m_limit = std::max<double>(m_minLimit, m_limit * BACKOFF_FACTOR);
+    } else {
+        m_limit = std::min<double>(m_maxLimit, m_limit + 1.0 / m_limit);
+    }
+}
+
+// =============================================================================
+// OutboundHttp
+// =============================================================================
+
+OutboundHttp::OutboundHttp(QObject* parent)
+    : QObject(parent)
+{
+}
+
+OutboundHttp::~OutboundHttp() = default;
+
+void OutboundHttp::submit(Sender send, Callback done, bool hedge)
+{
+    auto request = std::make_shared<Request>();
+    request->send = std::move(send);
+    request->done = std::move(done);
+    request->hedge = hedge;
+
+    m_queue.push_back(std::move(request));
+    dispatch();
+}
+
+QVariantMap OutboundHttp::stats() const
+{
+    return {
+        {"inFlight", m_limiter.inFlight()},
+        {"limit", m_limiter.limit()},
+        {"queued", queued()},
+        {"p50", m_latency.percentile(0.50)},
+        {"p95", m_latency.percentile(0.95)},
+        {"p99", m_latency.percentile(0.99)},
+        {"hedgesSent", m_hedgesSent},
+        {"hedgesWon", m_hedgesWon}
+    };
+}
+
+void OutboundHttp::dispatch()
+{
+    while (!m_queue.empty() && m_limiter.tryAcquire()) {
+        auto request = std::move(m_queue.front());
+        m_queue.pop_front();
+        start(request);
+    }
+
+    MetricCounters& counters = RulesMetrics::counters();
+    metrics::gauge(counters.httpInFlight, m_limiter.inFlight());
+    metrics::gauge(counters.httpQueued, queued());
+    emit inFlightChanged(m_limiter.inFlight());
+}
+
+void OutboundHttp::start(const std::shared_ptr<Request>& request)
+{
+    request->timer.start();
+    launch(request, false);
+
+    if (!request->hedge) {
+        return;
+    }
+
+    const int delay = hedgeDelayMs();
+    if (delay < 0) {
+        return;
+    }
+
+    QTimer::singleShot(delay, this, [this, request]() {
+        if (request->completed || !m_limiter.tryAcquire()) {
+            return;
+        }
+        ++m_hedgesSent;
+        launch(request, true);
+    });
+}
+
+void OutboundHttp::launch(const std::shared_ptr<Request>& request, bool isHedge)
+{
+    const qint64 startedAt = request->timer.elapsed();
+    QNetworkReply* reply = request->send();
+    request->attempts.append(reply);
+
+    connect(reply, &QNetworkReply::finished, this, [this, request, reply, isHedge, startedAt]() {
+        const qint64 latency = request->timer.elapsed() - startedAt;
+
+        if (request->completed) {
+            // Hedge loser (aborted or finished late): free the slot only
+            m_limiter.release(latency, ConcurrencyLimiter::Outcome::Ignored);
+            reply->deleteLater();
+            dispatch();
+            return;
+        }
+
+        request->completed = true;
+        const bool ok = reply->error() == QNetworkReply::NoError;
+        if (ok) {
+            m_latency.add(latency);
+        }
+        m_limiter.release(latency, ok ? ConcurrencyLimiter::Outcome::Success
+                                      : ConcurrencyLimiter::Outcome::Dropped);
+        if (isHedge) {
+            ++m_hedgesWon;
+        }
+
+        for (QNetworkReply* other : request->attempts) {
+            if (other != reply && other->isRunning()) {
+                other->abort();
+            }
+        }
+
+        request->done(reply);
+        reply->deleteLater();
+        dispatch();
+    });
+}
+
+int OutboundHttp::hedgeDelayMs() const
+{
+    if (m_latency.sampleCount() < MIN_SAMPLES_FOR_HEDGE) {
+        return -1;
+    }
+    return static_cast<int>(std::max<qint64>(MIN_HEDGE_DELAY_MS, m_latency.percentile(0.95)));
+}
+
+} // namespace rules
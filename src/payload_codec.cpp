@@ -0,0 +1,116 @@
+#include "payload_codec.h"
+
+#include <QCborValue>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace rules {
+
+namespace {
+
+QString displayText(const QByteArray& utf8)
+{
+    if (utf8.size() <= PayloadCodec::MAX_DISPLAY_BYTES) {
+        return QString::fromUtf8(utf8);
+    }
+    // Cut before a character, not inside one: step back over continuation
+    // bytes (10xxxxxx), at most three since a sequence is four bytes long
+    qsizetype cut = PayloadCodec::MAX_DISPLAY_BYTES;
+    for (int i = 0; i < 3 && (static_cast<uchar>(utf8.at(cut)) & 0xC0) == 0x80; ++i) {
+        --cut;
+    }
+    return QString::fromUtf8(QByteArrayView(utf8.constData(), cut))
+        + QString("\n... (%1 more bytes not shown)").arg(utf8.size() - cut);
+}
+
+bool looksLikeJson(const QByteArray& body)
+{
+    for (char c : body) {
+        if (c == ' ' || c == '\n' || c == '\r' || c == '\t') continue;
+        return c == '{' || c == '[';
+    }
+    return false;
+}
+
+} // namespace
+
+QFuture<EncodedPayload> PayloadCodec::encode(const QString& jsonText, PayloadFormat format)
+{
+    return QtConcurrent::run([jsonText, format]() {
+        return encodeNow(jsonText, format);
+    });
+}
+
+QFuture<DecodedPayload> PayloadCodec::decode(const QByteArray& body, const QString& contentType)
+{
+    return QtConcurrent::run([body, contentType]() {
+        return decodeNow(body, contentType);
+    });
+}
+
+EncodedPayload PayloadCodec::encodeNow(const QString& jsonText, PayloadFormat format)
+{
+    EncodedPayload result;
+
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(jsonText.toUtf8(), &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        result.error = QString("JSON parse error: %1").arg(parseError.errorString());
+        return result;
+    }
+
+    if (format == PayloadFormat::Cbor) {
+        QCborValue cbor = doc.isArray() ? QCborValue::fromJsonValue(doc.array())
+                                        : QCborValue::fromJsonValue(doc.object());
+        result.bytes = cbor.toCbor();
+    } else {
+        result.json = doc.object();
+    }
+
+    result.ok = true;
+    return result;
+}
+
+DecodedPayload PayloadCodec::decodeNow(const QByteArray& body, const QString& contentType)
+{
+    DecodedPayload result;
+    result.size = body.size();
+
+    if (contentType.contains("cbor", Qt::CaseInsensitive)) {
+        QCborParserError cborError;
+        QCborValue cbor = QCborValue::fromCbor(body, &cborError);
+        if (cborError.error == QCborError::NoError) {
+            result.ok = true;
+            result.value = cbor.toVariant();
+            QJsonValue json = cbor.toJsonValue();
+            QJsonDocument doc = json.isArray() ? QJsonDocument(json.toArray())
+                                               : QJsonDocument(json.toObject());
+            result.text = displayText(doc.toJson(QJsonDocument::Indented));
+        } else {
+            result.text = QString("CBOR parse error: %1").arg(cborError.errorString());
+        }
+        return result;
+    }
+
+    if (contentType.contains("json", Qt::CaseInsensitive) || looksLikeJson(body)) {
+        QJsonParseError parseError;
+        QJsonDocument doc = QJsonDocument::fromJson(body, &parseError);
+        if (parseError.error == QJsonParseError::NoError) {
+            result.ok = true;
+            result.value = doc.toVariant();
+        }
+    }
+
+    result.text = displayText(body);
+    return result;
+}
+
+QString PayloadCodec::contentType(PayloadFormat format)
+{
+    return format == PayloadFormat::Cbor ? QStringLiteral("application/cbor")
+                                         : QStringLiteral("application/json");
+}
+
+} // namespace rules
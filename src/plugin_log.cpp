@@ -0,0 +1,299 @@
+#include "plugin_log.h"
+#include "rules_metrics.h"
+
+#include <mpf/logger.h>
+
+#include <QByteArray>
+#include <QString>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rules::log {
+
+namespace {
+
+Level levelFromEnvironment()
+{
+    const QByteArray value = qgetenv("MPF_RULES_LOG_LEVEL").toLower();
+    if (value == "debug") return Level::Debug;
+    if (value == "warning") return Level::Warning;
+    if (value == "error") return Level::Error;
+    if (value == "off") return Level::Off;
+    return Level::Info;
+}
+
+qint64 steadyMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Bounded multi-producer queue (Vyukov): each cell carries a sequence
+ * number, so producers claim cells with one CAS and never block.
+ */
+class RecordQueue
+{
+public:
+    explicit RecordQueue(size_t capacity)
+        : m_cells(capacity)
+        , m_mask(capacity - 1)
+    {
+        for (size_t i = 0; i < capacity; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(Record&& record)
+    {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_cells[pos & m_mask];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.record = std::move(record);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // full
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Single consumer (the sink thread, or flush() under the sink mutex)
+    bool pop(Record& record)
+    {
+        Cell& cell = m_cells[m_dequeuePos & m_mask];
+        const size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(m_dequeuePos + 1) < 0) {
+            return false;  // empty
+        }
+        record = std::move(cell.record);
+        cell.record = Record();
+        cell.sequence.store(m_dequeuePos + m_mask + 1, std::memory_order_release);
+        ++m_dequeuePos;
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence{0};
+        Record record;
+    };
+
+    std::vector<Cell> m_cells;
+    const size_t m_mask;
+    alignas(64) std::atomic<size_t> m_enqueuePos{0};
+    alignas(64) size_t m_dequeuePos = 0;
+};
+
+void emitRecord(const Record& record)
+{
+    // One substitution pass: chained arg() calls would also expand
+    // placeholders that appear inside earlier argument values
+    const QString format = QString::fromUtf8(record.format);
+    std::array<QString, MAX_ARGS> args;
+    for (int i = 0; i < record.argc; ++i) {
+        args[static_cast<size_t>(i)] = record.args[static_cast<size_t>(i)].toString();
+    }
+    static_assert(MAX_ARGS == 4, "emitRecord() substitutes up to four arguments");
+    QString text;
+    switch (record.argc) {
+    case 0: text = format; break;
+    case 1: text = format.arg(args[0]); break;
+    case 2: text = format.arg(args[0], args[1]); break;
+    case 3: text = format.arg(args[0], args[1], args[2]); break;
+    default: text = format.arg(args[0], args[1], args[2], args[3]); break;
+    }
+
+    const std::string message = text.toStdString();
+    switch (record.level) {
+    case Level::Debug:
+        MPF_LOG_DEBUG(record.tag, message.c_str());
+        break;
+    case Level::Info:
+        MPF_LOG_INFO(record.tag, message.c_str());
+        break;
+    case Level::Warning:
+        MPF_LOG_WARNING(record.tag, message.c_str());
+        break;
+    case Level::Error:
+    case Level::Off:
+        MPF_LOG_ERROR(record.tag, message.c_str());
+        break;
+    }
+}
+
+class Sink
+{
+public:
+    ~Sink() { stop(); }
+
+    void push(Record&& record)
+    {
+        if (!ensureRunning()) {
+            // Closed: no thread may outlive stop(), so the caller formats
+            // its own record, after anything that slipped into the queue
+            std::lock_guard<std::mutex> lock(m_consumerMutex);
+            drainLocked();
+            emitRecord(record);
+            return;
+        }
+        if (!m_queue.push(std::move(record))) {
+            metrics::count(RulesMetrics::counters().logRecordsDropped);
+        }
+        if (m_sleeping.load(std::memory_order_acquire)) {
+            m_wake.notify_one();
+        }
+    }
+
+    void drain()
+    {
+        std::lock_guard<std::mutex> lock(m_consumerMutex);
+        drainLocked();
+    }
+
+    void open()
+    {
+        std::lock_guard<std::mutex> lifecycle(m_lifecycleMutex);
+        m_closed = false;
+    }
+
+    // Joins the thread and keeps it from being started again until open()
+    void stop()
+    {
+        std::lock_guard<std::mutex> lifecycle(m_lifecycleMutex);
+        m_closed = true;
+        if (!m_thread.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_stopping = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+        m_stopping = false;
+        drain();
+    }
+
+private:
+    void drainLocked()
+    {
+        Record record;
+        while (m_queue.pop(record)) {
+            emitRecord(record);
+        }
+    }
+
+    // False once stopped: records are then emitted synchronously
+    bool ensureRunning()
+    {
+        if (m_running.load(std::memory_order_acquire)) {
+            return true;
+        }
+        std::lock_guard<std::mutex> lifecycle(m_lifecycleMutex);
+        if (m_closed) {
+            return false;
+        }
+        if (!m_thread.joinable()) {
+            m_thread = std::thread([this]() { run(); });
+            m_running.store(true, std::memory_order_release);
+        }
+        return true;
+    }
+
+    void run()
+    {
+        for (;;) {
+            drain();
+
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            if (m_stopping) {
+                break;
+            }
+            m_sleeping.store(true, std::memory_order_release);
+            m_wake.wait_for(lock, std::chrono::milliseconds(20));
+            m_sleeping.store(false, std::memory_order_release);
+        }
+        m_running.store(false, std::memory_order_release);
+    }
+
+    RecordQueue m_queue{4096};
+    std::mutex m_consumerMutex;
+    std::mutex m_lifecycleMutex;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_sleeping{false};
+    bool m_stopping = false;
+    bool m_closed = false;      // guarded by m_lifecycleMutex
+};
+
+Sink& sink()
+{
+    static Sink instance;
+    return instance;
+}
+
+} // namespace
+
+std::atomic<int> g_level{static_cast<int>(levelFromEnvironment())};
+
+void setLevel(Level level)
+{
+    g_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+Level level()
+{
+    return static_cast<Level>(g_level.load(std::memory_order_relaxed));
+}
+
+void enqueue(Record&& record)
+{
+    sink().push(std::move(record));
+}
+
+void flush()
+{
+    sink().drain();
+}
+
+void open()
+{
+    sink().open();
+}
+
+void shutdown()
+{
+    sink().stop();
+}
+
+bool RateLimiter::allow()
+{
+    const qint64 window = steadyMs() / 1000;
+    qint64 current = m_window.load(std::memory_order_relaxed);
+    if (current != window && m_window.compare_exchange_strong(current, window, std::memory_order_relaxed)) {
+        m_count.store(0, std::memory_order_relaxed);
+    }
+
+    if (m_count.fetch_add(1, std::memory_order_relaxed) < m_perSecond) {
+        return true;
+    }
+    m_suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+} // namespace rules::log
@@ -0,0 +1,105 @@
+#include "result_cache.h"
+
+namespace rules {
+
+namespace {
+
+bool sameValue(const expr::Value& a, const expr::Value& b)
+{
+    return a.type == b.type && a.number == b.number && a.string == b.string;
+}
+
+} // namespace
+
+ResultCache::ResultCache(size_t capacity)
+    : m_entries(qMax<size_t>(1, capacity))
+{
+    m_index.reserve(static_cast<qsizetype>(m_entries.size()));
+}
+
+size_t ResultCache::hashFields(quint64 version, const std::vector<int>& fieldSlots,
+                               const expr::Value* fields)
+{
+    size_t seed = qHash(version);
+    for (int slot : fieldSlots) {
+        const expr::Value& value = fields[slot];
+        seed = qHash(static_cast<int>(value.type), seed);
+        seed = value.type == expr::ValueType::String ? qHash(value.string, seed)
+                                                     : qHash(value.number, seed);
+    }
+    return seed;
+}
+
+const std::vector<int>* ResultCache::find(quint64 version, const std::vector<int>& fieldSlots,
+                                          const expr::Value* fields, size_t hash)
+{
+    if (version != m_version) {
+        reset(version);
+        return nullptr;
+    }
+
+    const auto it = m_index.constFind(hash);
+    if (it == m_index.cend()) {
+        return nullptr;
+    }
+
+    Entry& entry = m_entries[static_cast<size_t>(*it)];
+    for (size_t i = 0; i < fieldSlots.size(); ++i) {
+        if (!sameValue(entry.key[i], fields[fieldSlots[i]])) {
+            return nullptr;
+        }
+    }
+    entry.referenced = true;
+    return &entry.matched;
+}
+
+void ResultCache::insert(quint64 version, const std::vector<int>& fieldSlots,
+                         const expr::Value* fields, size_t hash, const std::vector<int>& matched)
+{
+    if (version != m_version) {
+        reset(version);
+    }
+
+    // Replacing a colliding entry keeps the index one-to-one
+    auto existing = m_index.constFind(hash);
+    size_t victim = 0;
+    if (existing != m_index.cend()) {
+        victim = static_cast<size_t>(*existing);
+    } else {
+        while (m_entries[m_hand].used && m_entries[m_hand].referenced) {
+            m_entries[m_hand].referenced = false;
+            m_hand = (m_hand + 1) % m_entries.size();
+        }
+        victim = m_hand;
+        m_hand = (m_hand + 1) % m_entries.size();
+        if (m_entries[victim].used) {
+            m_index.remove(m_entries[victim].hash);
+        }
+        m_index.insert(hash, static_cast<int>(victim));
+    }
+
+    Entry& entry = m_entries[victim];
+    entry.hash = hash;
+    entry.key.resize(fieldSlots.size());
+    for (size_t i = 0; i < fieldSlots.size(); ++i) {
+        entry.key[i] = fields[fieldSlots[i]];
+    }
+    entry.matched.assign(matched.begin(), matched.end());
+    entry.used = true;
+    entry.referenced = false;
+}
+
+void ResultCache::reset(quint64 version)
+{
+    m_version = version;
+    m_index.clear();
+    for (Entry& entry : m_entries) {
+        entry.used = false;
+        entry.referenced = false;
+        entry.key.clear();
+        entry.matched.clear();
+    }
+    m_hand = 0;
+}
+
+} // namespace rules
@@ -0,0 +1,161 @@
+#include "result_publisher.h"
+#include "rules_metrics.h"
+#include "trace.h"
+
+#include <mpf/interfaces/ieventbus.h>
+
+namespace rules {
+
+ResultPublisher::ResultPublisher(const QString& pluginId, QObject* parent)
+    : QObject(parent)
+    , m_pluginId(pluginId)
+{
+    m_delayTimer.setSingleShot(true);
+    connect(&m_delayTimer, &QTimer::timeout, this, &ResultPublisher::flush);
+}
+
+// Unflushed results are dropped: the bus may already be gone at teardown
+ResultPublisher::~ResultPublisher() = default;
+
+void ResultPublisher::setBatchLimits(int maxResults, int maxDelayMs)
+{
+    m_maxResults = qMax(1, maxResults);
+    m_maxDelayMs = qMax(0, maxDelayMs);
+}
+
+void ResultPublisher::add(const CheckResult& result)
+{
+    bool first = false;
+    bool full = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.push_back(result);
+        first = m_pending.size() == 1;
+        full = !m_flushQueued && static_cast<int>(m_pending.size()) >= m_maxResults;
+        m_flushQueued = m_flushQueued || full;
+    }
+
+    // The timer lives on this object's thread; add() may not
+    if (full) {
+        QMetaObject::invokeMethod(this, &ResultPublisher::flush, Qt::QueuedConnection);
+    } else if (first) {
+        QMetaObject::invokeMethod(this, [this]() {
+            if (!m_delayTimer.isActive()) {
+                m_delayTimer.start(m_maxDelayMs);
+            }
+        }, Qt::QueuedConnection);
+    }
+}
+
+void ResultPublisher::flush()
+{
+    std::vector<CheckResult> results;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        results.swap(m_pending);
+        m_flushQueued = false;
+    }
+    m_delayTimer.stop();
+    if (results.empty() || !m_eventBus) {
+        return;
+    }
+
+    RULES_TRACE_SCOPE("ResultPublisher::flush");
+    const QVariantMap batch = encode(results);
+    m_eventBus->publish("rules/check/batch", batch, m_pluginId);
+
+    MetricCounters& counters = RulesMetrics::counters();
+    metrics::count(counters.resultBatches);
+    metrics::count(counters.resultsPublished, static_cast<quint64>(results.size()));
+
+    if (m_splitting) {
+        for (const QVariantMap& result : split(batch)) {
+            m_eventBus->publish("rules/check/completed", result, m_pluginId);
+        }
+    }
+}
+
+QVariantMap ResultPublisher::encode(const std::vector<CheckResult>& results)
+{
+    const auto count = static_cast<qsizetype>(results.size());
+    QStringList orderIds;
+    QByteArray passed(count, '\0');
+    QList<qint64> checkedAt;
+    QStringList ruleIds;
+    QStringList ruleNames;
+    QHash<QString, int> ruleIndex;
+    QList<int> matchOffsets;
+    QList<int> matches;
+
+    orderIds.reserve(count);
+    checkedAt.reserve(count);
+    matchOffsets.reserve(count + 1);
+    matchOffsets.append(0);
+
+    for (qsizetype i = 0; i < count; ++i) {
+        const CheckResult& result = results[static_cast<size_t>(i)];
+        orderIds.append(result.orderId);
+        passed[i] = result.matchedRules.isEmpty() ? 1 : 0;
+        checkedAt.append(result.checkedAt);
+
+        for (qsizetype m = 0; m < result.matchedRules.size(); ++m) {
+            auto it = ruleIndex.constFind(result.matchedRules.at(m));
+            if (it == ruleIndex.cend()) {
+                it = ruleIndex.insert(result.matchedRules.at(m), static_cast<int>(ruleIds.size()));
+                ruleIds.append(result.matchedRules.at(m));
+                ruleNames.append(result.reasons.value(m));
+            }
+            matches.append(*it);
+        }
+        matchOffsets.append(static_cast<int>(matches.size()));
+    }
+
+    return {
+        {"count", static_cast<int>(count)},
+        {"orderIds", orderIds},
+        {"passed", passed},
+        {"checkedAt", QVariant::fromValue(checkedAt)},
+        {"ruleIds", ruleIds},
+        {"ruleNames", ruleNames},
+        {"matchOffsets", QVariant::fromValue(matchOffsets)},
+        {"matches", QVariant::fromValue(matches)}
+    };
+}
+
+QList<QVariantMap> ResultPublisher::split(const QVariantMap& batch)
+{
+    const int count = batch.value("count").toInt();
+    const QStringList orderIds = batch.value("orderIds").toStringList();
+    const QByteArray passed = batch.value("passed").toByteArray();
+    const auto checkedAt = batch.value("checkedAt").value<QList<qint64>>();
+    const QStringList ruleIds = batch.value("ruleIds").toStringList();
+    const QStringList ruleNames = batch.value("ruleNames").toStringList();
+    const auto matchOffsets = batch.value("matchOffsets").value<QList<int>>();
+    const auto matches = batch.value("matches").value<QList<int>>();
+
+    QList<QVariantMap> results;
+    if (orderIds.size() < count || passed.size() < count || checkedAt.size() < count
+        || matchOffsets.size() < count + 1) {
+        return results;     // not a batch this version wrote
+    }
+
+    results.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        QStringList matchedRules;
+        QStringList reasons;
+        for (int m = matchOffsets[i]; m < matchOffsets[i + 1] && m < matches.size(); ++m) {
+            matchedRules.append(ruleIds.value(matches[m]));
+            reasons.append(ruleNames.value(matches[m]));
+        }
+        results.append({
+            {"orderId", orderIds[i]},
+            {"passed", passed[i] != 0},
+            {"matchedRules", matchedRules},
+            {"reason", reasons.join(QStringLiteral(", "))},
+            {"checkedAt", checkedAt[i]}
+        });
+    }
+    return results;
+}
+
+} // namespace rules
@@ -0,0 +1,457 @@
+#include "rule_bulk_io.h"
+#include "trace.h"
+
+#include <QFile>
+#include <QIODevice>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QLocale>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace rules {
+
+namespace {
+
+enum Column { Id, CustomerName, ProductName, Quantity, Price, Status, CreatedAt, UpdatedAt, Condition, ColumnCount };
+
+const char* const COLUMN_NAMES[ColumnCount] = {
+    "id", "customerName", "productName", "quantity", "price",
+    "status", "createdAt", "updatedAt", "condition"
+};
+
+using ColumnMap = std::array<int, ColumnCount>;    // column -> CSV field index, -1 if absent
+
+void reject(BulkParseResult& result, const char* record, qsizetype length, const QString& reason)
+{
+    if (result.rejected++ == 0) {
+        result.firstRejection = QString("%1 in \"%2\"")
+            .arg(reason, QString::fromUtf8(record, qMin<qsizetype>(length, 80)));
+    }
+}
+
+QDateTime timeFromText(const QString& text)
+{
+    if (text.isEmpty()) {
+        return {};
+    }
+    bool ok = false;
+    const qint64 ms = text.toLongLong(&ok);
+    return ok ? QDateTime::fromMSecsSinceEpoch(ms) : QDateTime::fromString(text, Qt::ISODateWithMs);
+}
+
+QDateTime timeFromJson(const QJsonValue& value)
+{
+    return value.isDouble() ? QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(value.toDouble()))
+                            : timeFromText(value.toString());
+}
+
+// ============================================================================
+// JSON Lines
+// ============================================================================
+
+void parseJsonLines(QByteArrayView chunk, BulkParseResult& result)
+{
+    const char* p = chunk.data();
+    const char* const end = p + chunk.size();
+    while (p < end) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!eol) {
+            eol = end;
+        }
+        const char* first = p;
+        const char* last = eol;
+        p = eol == end ? end : eol + 1;
+
+        while (first < last && (*first == ' ' || *first == '\t')) ++first;
+        while (last > first && (last[-1] == '\r' || last[-1] == ' ' || last[-1] == '\t')) --last;
+        if (first == last) {
+            continue;
+        }
+
+        QJsonParseError error;
+        const QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromRawData(first, last - first), &error);
+        if (!doc.isObject()) {
+            reject(result, first, last - first,
+                   error.error != QJsonParseError::NoError ? error.errorString() : QString("not an object"));
+            continue;
+        }
+
+        const QJsonObject object = doc.object();
+        Rule rule;
+        rule.id = object.value("id").toString();
+        rule.customerName = object.value("customerName").toString();
+        rule.productName = object.value("productName").toString();
+        rule.quantity = object.value("quantity").toInt();
+        rule.price = object.value("price").toDouble();
+        rule.status = object.value("status").toString();
+        rule.createdAt = timeFromJson(object.value("createdAt"));
+        rule.updatedAt = timeFromJson(object.value("updatedAt"));
+        rule.condition = object.value("condition").toString();
+        result.rules.append(std::move(rule));
+    }
+}
+
+// ============================================================================
+// CSV
+// ============================================================================
+
+// Reads one record into `fields`; returns the position after it
+const char* readCsvRecord(const char* p, const char* end, QList<QString>& fields)
+{
+    fields.clear();
+    QByteArray quoted;
+    for (;;) {
+        if (p < end && *p == '"') {
+            quoted.clear();
+            ++p;
+            while (p < end) {
+                if (*p == '"') {
+                    if (p + 1 < end && p[1] == '"') {
+                        quoted += '"';
+                        p += 2;
+                        continue;
+                    }
+                    ++p;
+                    break;
+                }
+                const char* q = static_cast<const char*>(std::memchr(p, '"', end - p));
+                if (!q) {
+                    q = end;
+                }
+                quoted.append(p, q - p);
+                p = q;
+            }
+            fields.append(QString::fromUtf8(quoted));
+            while (p < end && *p != ',' && *p != '\n') ++p;     // anything after the closing quote
+        } else {
+            const char* start = p;
+            while (p < end && *p != ',' && *p != '\n') ++p;
+            const char* stop = p > start && p[-1] == '\r' ? p - 1 : p;
+            fields.append(QString::fromUtf8(start, stop - start));
+        }
+
+        if (p >= end) {
+            return end;
+        }
+        if (*p == '\n') {
+            return p + 1;
+        }
+        ++p;    // ','
+    }
+}
+
+void parseCsv(QByteArrayView chunk, const ColumnMap& columns, BulkParseResult& result)
+{
+    QList<QString> fields;
+    const char* p = chunk.data();
+    const char* const end = p + chunk.size();
+    while (p < end) {
+        const char* record = p;
+        p = readCsvRecord(p, end, fields);
+        if (fields.size() == 1 && fields.first().isEmpty()) {
+            continue;   // blank line
+        }
+
+        auto field = [&](Column column) {
+            const int i = columns[column];
+            return i >= 0 && i < fields.size() ? fields.at(i) : QString();
+        };
+
+        bool quantityOk = true;
+        bool priceOk = true;
+        const QString quantity = field(Quantity);
+        const QString price = field(Price);
+
+        Rule rule;
+        rule.id = field(Id);
+        rule.customerName = field(CustomerName);
+        rule.productName = field(ProductName);
+        rule.quantity = quantity.isEmpty() ? 0 : quantity.toInt(&quantityOk);
+        rule.price = price.isEmpty() ? 0 : price.toDouble(&priceOk);
+        rule.status = field(Status);
+        rule.createdAt = timeFromText(field(CreatedAt));
+        rule.updatedAt = timeFromText(field(UpdatedAt));
+        rule.condition = field(Condition);
+        if (!quantityOk || !priceOk) {
+            reject(result, record, p - record, QString("bad %1").arg(quantityOk ? "price" : "quantity"));
+            continue;
+        }
+        result.rules.append(std::move(rule));
+    }
+}
+
+// Cuts data into about `chunks` pieces, each ending after a record. For
+// CSV a newline only ends a record outside quotes, so the quotes before
+// each cut are counted (one forward pass over the data in total).
+std::vector<QByteArrayView> splitRecords(QByteArrayView data, BulkFormat format, int chunks)
+{
+    std::vector<QByteArrayView> pieces;
+    const char* const begin = data.data();
+    const char* const end = begin + data.size();
+    const char* start = begin;
+    const char* counted = begin;
+    qsizetype quotes = 0;
+
+    for (int i = 1; i < chunks && start < end; ++i) {
+        const char* cut = begin + data.size() * i / chunks;
+        if (cut <= start) {
+            continue;
+        }
+        for (;;) {
+            const char* newline = static_cast<const char*>(std::memchr(cut, '\n', end - cut));
+            if (!newline) {
+                cut = end;
+                break;
+            }
+            cut = newline + 1;
+            if (format != BulkFormat::Csv) {
+                break;
+            }
+            quotes += std::count(counted, newline, '"');
+            counted = newline;
+            if (quotes % 2 == 0) {
+                break;
+            }
+        }
+        pieces.emplace_back(start, cut - start);
+        start = cut;
+    }
+    if (start < end) {
+        pieces.emplace_back(start, end - start);
+    }
+    return pieces;
+}
+
+// ============================================================================
+// Writing
+// ============================================================================
+
+void appendJsonString(QByteArray& out, const QString& text)
+{
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (char c : text.toUtf8()) {
+        switch (c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                out += "\\u00";
+                out += hex[(c >> 4) & 0xF];
+                out += hex[c & 0xF];
+            } else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+void appendCsvField(QByteArray& out, const QString& text)
+{
+    const QByteArray utf8 = text.toUtf8();
+    if (utf8.indexOf(',') < 0 && utf8.indexOf('"') < 0 && utf8.indexOf('\n') < 0 && utf8.indexOf('\r') < 0) {
+        out += utf8;
+        return;
+    }
+    out += '"';
+    for (char c : utf8) {
+        if (c == '"') {
+            out += '"';
+        }
+        out += c;
+    }
+    out += '"';
+}
+
+QByteArray timeText(const QDateTime& time)
+{
+    return time.isValid() ? QByteArray::number(time.toMSecsSinceEpoch()) : QByteArray();
+}
+
+void appendJsonRecord(QByteArray& out, const Rule& rule)
+{
+    out += "{\"id\":";
+    appendJsonString(out, rule.id);
+    out += ",\"customerName\":";
+    appendJsonString(out, rule.customerName);
+    out += ",\"productName\":";
+    appendJsonString(out, rule.productName);
+    out += ",\"quantity\":";
+    out += QByteArray::number(rule.quantity);
+    out += ",\"price\":";
+    out += QByteArray::number(rule.price, 'g', QLocale::FloatingPointShortest);
+    out += ",\"status\":";
+    appendJsonString(out, rule.status);
+    out += ",\"createdAt\":";
+    out += rule.createdAt.isValid() ? timeText(rule.createdAt) : QByteArray("null");
+    out += ",\"updatedAt\":";
+    out += rule.updatedAt.isValid() ? timeText(rule.updatedAt) : QByteArray("null");
+    out += ",\"condition\":";
+    appendJsonString(out, rule.condition);
+    out += "}\n";
+}
+
+void appendCsvRecord(QByteArray& out, const Rule& rule)
+{
+    appendCsvField(out, rule.id);
+    out += ',';
+    appendCsvField(out, rule.customerName);
+    out += ',';
+    appendCsvField(out, rule.productName);
+    out += ',';
+    out += QByteArray::number(rule.quantity);
+    out += ',';
+    out += QByteArray::number(rule.price, 'g', QLocale::FloatingPointShortest);
+    out += ',';
+    appendCsvField(out, rule.status);
+    out += ',';
+    out += timeText(rule.createdAt);
+    out += ',';
+    out += timeText(rule.updatedAt);
+    out += ',';
+    appendCsvField(out, rule.condition);
+    out += '\n';
+}
+
+} // namespace
+
+BulkFormat RuleBulkIo::formatForPath(const QString& path)
+{
+    return path.endsWith(QLatin1String(".csv"), Qt::CaseInsensitive) ? BulkFormat::Csv : BulkFormat::JsonLines;
+}
+
+BulkParseResult RuleBulkIo::parseFile(const QString& path, BulkFormat format)
+{
+    RULES_TRACE_SCOPE("RuleBulkIo::parseFile");
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        BulkParseResult result;
+        result.error = file.errorString();
+        return result;
+    }
+
+    const qint64 size = file.size();
+    if (size == 0) {
+        return parse(QByteArrayView(), format);
+    }
+
+    // Records are copied into QStrings while parsing, so the mapping can
+    // go as soon as parse() returns
+    if (uchar* mapped = file.map(0, size)) {
+        BulkParseResult result = parse(QByteArrayView(reinterpret_cast<const char*>(mapped), size), format);
+        file.unmap(mapped);
+        return result;
+    }
+    const QByteArray bytes = file.readAll();
+    return parse(bytes, format);
+}
+
+BulkParseResult RuleBulkIo::parse(QByteArrayView data, BulkFormat format, int chunks)
+{
+    RULES_TRACE_SCOPE("RuleBulkIo::parse");
+    BulkParseResult result;
+
+    ColumnMap columns;
+    columns.fill(-1);
+    if (format == BulkFormat::Csv && !data.isEmpty()) {
+        QList<QString> header;
+        const char* body = readCsvRecord(data.data(), data.data() + data.size(), header);
+        bool known = false;
+        for (int i = 0; i < header.size(); ++i) {
+            for (int column = 0; column < ColumnCount; ++column) {
+                if (header.at(i).trimmed() == QLatin1String(COLUMN_NAMES[column])) {
+                    columns[column] = i;
+                    known = true;
+                }
+            }
+        }
+        if (!known) {
+            result.error = "CSV header names none of the rule fields";
+            return result;
+        }
+        data = QByteArrayView(body, data.data() + data.size() - body);
+    }
+
+    if (chunks <= 0) {
+        chunks = static_cast<int>(qBound<qsizetype>(1, data.size() / MIN_CHUNK_BYTES,
+                                                    QThreadPool::globalInstance()->maxThreadCount() * 4));
+    }
+
+    auto parseChunk = [format, &columns](QByteArrayView chunk) {
+        BulkParseResult part;
+        if (format == BulkFormat::Csv) {
+            parseCsv(chunk, columns, part);
+        } else {
+            parseJsonLines(chunk, part);
+        }
+        return part;
+    };
+
+    const std::vector<QByteArrayView> pieces = splitRecords(data, format, chunks);
+    std::vector<BulkParseResult> parts;
+    if (pieces.size() > 1) {
+        parts = QtConcurrent::blockingMapped<std::vector<BulkParseResult>>(pieces, parseChunk);
+    } else if (!pieces.empty()) {
+        parts.push_back(parseChunk(pieces.front()));
+    }
+
+    qsizetype total = 0;
+    for (const BulkParseResult& part : parts) {
+        total += part.rules.size();
+    }
+    result.rules.reserve(total);
+    for (BulkParseResult& part : parts) {
+        result.rules.append(std::move(part.rules));
+        if (result.rejected == 0 && part.rejected > 0) {
+            result.firstRejection = part.firstRejection;
+        }
+        result.rejected += part.rejected;
+    }
+    return result;
+}
+
+bool RuleBulkIo::write(QIODevice* device, const QList<Rule>& rules, BulkFormat format)
+{
+    RULES_TRACE_SCOPE("RuleBulkIo::write");
+    constexpr qsizetype FLUSH_BYTES = 64 * 1024;
+
+    QByteArray buffer;
+    buffer.reserve(FLUSH_BYTES + 4096);
+    auto flush = [device, &buffer]() {
+        const bool ok = device->write(buffer) == buffer.size();
+        buffer.resize(0);   // keeps the capacity
+        return ok;
+    };
+
+    if (format == BulkFormat::Csv) {
+        for (int column = 0; column < ColumnCount; ++column) {
+            buffer += column > 0 ? "," : "";
+            buffer += COLUMN_NAMES[column];
+        }
+        buffer += '\n';
+    }
+
+    for (const Rule& rule : rules) {
+        if (format == BulkFormat::Csv) {
+            appendCsvRecord(buffer, rule);
+        } else {
+            appendJsonRecord(buffer, rule);
+        }
+        if (buffer.size() >= FLUSH_BYTES && !flush()) {
+            return false;
+        }
+    }
+    return flush();
+}
+
+} // namespace rules
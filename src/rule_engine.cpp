@@ -0,0 +1,241 @@
+#include "rule_engine.h"
+#include "window_aggregator.h"
+#include "correlation_store.h"
+#include "plugin_log.h"
+#include "rules_metrics.h"
+#include "rules_service.h"
+#include "rule_set.h"
+#include "shadow_evaluator.h"
+#include "sharded_checker.h"
+#include "result_publisher.h"
+#include "work_stealing_pool.h"
+#include "epoch.h"
+#include "trace.h"
+
+#include <mpf/interfaces/ieventbus.h>
+
+#include <QDateTime>
+
+namespace rules {
+
+namespace {
+
+constexpr qint64 MINUTE_MS = 60 * 1000;
+constexpr qint64 DAY_MS = 24 * 60 * MINUTE_MS;
+
+int positiveFromEnvironment(const char* name, int fallback)
+{
+    bool ok = false;
+    const int value = qEnvironmentVariableIntValue(name, &ok);
+    return ok && value > 0 ? value : fallback;
+}
+
+} // namespace
+
+RuleEngine::RuleEngine(const QString& pluginId, QObject* parent)
+    : QObject(parent)
+    , m_pluginId(pluginId)
+{
+    RULES_TRACE_SCOPE("RuleEngine::RuleEngine");
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    m_aggregator = std::make_unique<WindowAggregator>(
+        std::vector<WindowSpec>{
+            {"orders10m", WindowKind::Sliding, 10 * MINUTE_MS, 10},
+            {"ordersDaily", WindowKind::Tumbling, DAY_MS, 1}
+        },
+        static_cast<size_t>(positiveFromEnvironment("MPF_RULES_WINDOW_MAX_KEYS", 100000)), now);
+
+    m_orders = std::make_unique<CorrelationStore>(
+        positiveFromEnvironment("MPF_RULES_CORRELATION_TTL_S", 86400) * qint64(1000),
+        static_cast<size_t>(positiveFromEnvironment("MPF_RULES_CORRELATION_MAX_ORDERS", 200000)), now);
+
+    bool ok = false;
+    const int threads = qEnvironmentVariableIntValue("MPF_RULES_EVAL_THREADS", &ok);
+    m_pool = std::make_unique<WorkStealingPool>(ok ? threads : 0);
+
+    // Results leave in batches; per-order events only on request
+    m_results = std::make_unique<ResultPublisher>(m_pluginId);
+    m_results->setBatchLimits(positiveFromEnvironment("MPF_RULES_RESULT_BATCH", 256),
+                              positiveFromEnvironment("MPF_RULES_RESULT_DELAY_MS", 20));
+    m_results->setSplitting(qEnvironmentVariable("MPF_RULES_SPLIT_RESULTS") == "1");
+
+    // One pass per wheel tick keeps expiry work small and evenly spread
+    connect(&m_expiryTimer, &QTimer::timeout, this, &RuleEngine::expireIdleKeys);
+    m_expiryTimer.start(1000);
+}
+
+RuleEngine::~RuleEngine() = default;
+
+void RuleEngine::setRulesService(RulesService* rulesService)
+{
+    m_checker.reset();
+    m_shadow.reset();
+    m_rulesService = rulesService;
+    if (!m_rulesService) {
+        return;
+    }
+
+    m_shadow = std::make_unique<ShadowEvaluator>(m_rulesService->candidateRules());
+    // Several shards per worker so a few busy customers still leave work
+    // for the others to steal
+    bool ok = false;
+    const int memoEntries = qEnvironmentVariableIntValue("MPF_RULES_MEMO_ENTRIES", &ok);
+    m_checker = std::make_unique<ShardedChecker>(
+        *m_rulesService, *m_pool, m_aggregator->windows(), m_pool->threadCount() * 8,
+        [this](const CheckResult& result) { m_results->add(result); },
+        m_shadow.get(), static_cast<size_t>(ok ? qMax(0, memoEntries) : 65536));
+}
+
+void RuleEngine::connectToEventBus(mpf::IEventBus* eventBus)
+{
+    auto* eventBusObj = dynamic_cast<QObject*>(eventBus);
+    if (!eventBusObj) {
+        return;
+    }
+    m_eventBus = eventBus;
+    m_results->setEventBus(eventBus);
+
+    QString subId;
+    QMetaObject::invokeMethod(eventBusObj, "subscribeSimple",
+        Q_RETURN_ARG(QString, subId),
+        Q_ARG(QString, QString("orders/**")),
+        Q_ARG(QString, m_pluginId + ".engine"));
+
+    RULES_LOG_INFO("RuleEngine", "Connected to EventBus, tracking %1 windows per customer",
+                   static_cast<int>(m_aggregator->windows().size()));
+}
+
+QVariantMap RuleEngine::customerWindows(const QString& customer) const
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QVariantMap result;
+    const auto& windows = m_aggregator->windows();
+    for (size_t i = 0; i < windows.size(); ++i) {
+        const WindowStats stats = m_aggregator->stats(customer, static_cast<int>(i), now);
+        result.insert(windows[i].name, QVariantMap{
+            {"count", stats.count},
+            {"sum", stats.sum},
+            {"min", stats.min},
+            {"max", stats.max}
+        });
+    }
+    return result;
+}
+
+void RuleEngine::onEventReceived(const QString& topic, const QVariantMap& data,
+                                 const QString& senderId)
+{
+    if (!topic.startsWith(QLatin1String("orders/")) || senderId == m_pluginId) {
+        return;
+    }
+
+    RULES_TRACE_SCOPE("RuleEngine::onEventReceived");
+    metrics::count(RulesMetrics::counters().orderEvents);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    if (topic == QLatin1String("orders/created")) {
+        onOrderCreated(data, now);
+    } else if (topic == QLatin1String("orders/status_changed")) {
+        onOrderStatusChanged(data, now);
+    } else if (topic == QLatin1String("orders/deleted")) {
+        m_orders->remove(data.value("orderId").toString());
+    }
+
+    MetricCounters& counters = RulesMetrics::counters();
+    metrics::gauge(counters.windowKeys, static_cast<qint64>(m_aggregator->keyCount()));
+    metrics::gauge(counters.correlatedOrders, static_cast<qint64>(m_orders->size()));
+}
+
+void RuleEngine::onOrderCreated(const QVariantMap& data, qint64 nowMs)
+{
+    OrderProjection order;
+    order.customerName = data.value("customerName").toString();
+    order.status = data.value("status").toString();
+    order.totalAmount = data.value("totalAmount").toDouble();
+    order.createdAtMs = nowMs;
+
+    const QString orderId = data.value("orderId").toString();
+    if (!orderId.isEmpty()) {
+        m_orders->put(orderId, order, nowMs);
+    }
+
+    if (!order.customerName.isEmpty()) {
+        const quint64 evictedBefore = m_aggregator->evictedKeys();
+        m_aggregator->add(order.customerName, order.totalAmount, nowMs);
+        metrics::count(RulesMetrics::counters().windowKeysEvicted,
+                       m_aggregator->evictedKeys() - evictedBefore);
+    }
+
+    // After aggregation, so window fields include this order
+    checkOrder(data, orderId, order.customerName, nowMs);
+}
+
+void RuleEngine::onOrderStatusChanged(const QVariantMap& data, qint64 nowMs)
+{
+    MetricCounters& counters = RulesMetrics::counters();
+    const QString orderId = data.value("orderId").toString();
+
+    // Joined against the earlier orders/created payload, no round trip
+    OrderProjection* order = m_orders->touch(orderId, nowMs);
+    if (!order) {
+        metrics::count(counters.correlationMisses);
+        return;
+    }
+    metrics::count(counters.correlationHits);
+
+    order->status = data.value("newStatus").toString();
+    if (order->status == QLatin1String("shipped")) {
+        RULES_LOG_RATE_LIMITED(log::Level::Debug, 100, "RuleEngine",
+                               "Order %1 shipped: customer %2, amount %3",
+                               orderId, order->customerName, order->totalAmount);
+    }
+}
+
+// =============================================================================
+// Condition evaluation
+// =============================================================================
+
+void RuleEngine::checkOrder(const QVariantMap& data, const QString& orderId,
+                            const QString& customer, qint64 nowMs)
+{
+    if (!m_checker) {
+        return;
+    }
+
+    RULES_TRACE_SCOPE("RuleEngine::checkOrder");
+    {
+        epoch::Guard guard;
+        if (m_rulesService->compiledRules().acquire()->rules.empty()
+            && !m_rulesService->hasCandidate()) {
+            return;     // nothing to evaluate, skip the hand-off
+        }
+    }
+
+    // Window state stays on this thread; the check gets a copy of the
+    // customer's stats
+    CheckRequest request;
+    request.orderId = orderId;
+    request.customer = customer;
+    request.data = data;
+    request.nowMs = nowMs;
+    const auto& windows = m_aggregator->windows();
+    request.windows.reserve(windows.size());
+    for (size_t w = 0; w < windows.size(); ++w) {
+        request.windows.push_back(m_aggregator->stats(customer, static_cast<int>(w), nowMs));
+    }
+    m_checker->submit(std::move(request));
+}
+
+void RuleEngine::expireIdleKeys()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    m_aggregator->advance(now);
+    m_orders->advance(now);
+
+    MetricCounters& counters = RulesMetrics::counters();
+    metrics::gauge(counters.windowKeys, static_cast<qint64>(m_aggregator->keyCount()));
+    metrics::gauge(counters.correlatedOrders, static_cast<qint64>(m_orders->size()));
+}
+
+} // namespace rules
@@ -0,0 +1,805 @@
+#include "rule_expression.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rules::expr {
+
+namespace {
+
+// =============================================================================
+// Values
+// =============================================================================
+
+bool equals(const Value& a, const Value& b)
+{
+    if (a.type != b.type) {
+        return false;
+    }
+    switch (a.type) {
+    case ValueType::Null:
+        return true;
+    case ValueType::Bool:
+    case ValueType::Number:
+        return a.number == b.number;
+    case ValueType::String:
+        return a.string == b.string;
+    }
+    return false;
+}
+
+Value applyUnary(OpCode op, const Value& value)
+{
+    switch (op) {
+    case OpCode::Truthy:
+        return Value::fromBool(value.truthy());
+    case OpCode::Not:
+        return Value::fromBool(!value.truthy());
+    case OpCode::Neg:
+        return value.type == ValueType::Number ? Value::fromNumber(-value.number) : Value();
+    default:
+        return Value();
+    }
+}
+
+Value applyBinary(OpCode op, const Value& a, const Value& b)
+{
+    // Fast path: the overwhelmingly common numeric field vs. constant case
+    if (a.type == ValueType::Number && b.type == ValueType::Number) {
+        switch (op) {
+        case OpCode::Add: return Value::fromNumber(a.number + b.number);
+        case OpCode::Sub: return Value::fromNumber(a.number - b.number);
+        case OpCode::Mul: return Value::fromNumber(a.number * b.number);
+        case OpCode::Div: return Value::fromNumber(a.number / b.number);
+        case OpCode::Mod: return Value::fromNumber(std::fmod(a.number, b.number));
+        case OpCode::Eq: return Value::fromBool(a.number == b.number);
+        case OpCode::Ne: return Value::fromBool(a.number != b.number);
+        case OpCode::Lt: return Value::fromBool(a.number < b.number);
+        case OpCode::Le: return Value::fromBool(a.number <= b.number);
+        case OpCode::Gt: return Value::fromBool(a.number > b.number);
+        case OpCode::Ge: return Value::fromBool(a.number >= b.number);
+        default: return Value();
+        }
+    }
+
+    switch (op) {
+    case OpCode::Eq:
+        return Value::fromBool(equals(a, b));
+    case OpCode::Ne:
+        return Value::fromBool(!equals(a, b));
+    case OpCode::Add:
+        if (a.type == ValueType::String && b.type == ValueType::String) {
+            return Value::fromString(a.string + b.string);
+        }
+        return Value();
+    case OpCode::Lt:
+    case OpCode::Le:
+    case OpCode::Gt:
+    case OpCode::Ge: {
+        // Ordering is only defined within strings (and numbers, above)
+        if (a.type != ValueType::String || b.type != ValueType::String) {
+            return Value::fromBool(false);
+        }
+        const int c = a.string.compare(b.string);
+        return Value::fromBool(op == OpCode::Lt ? c < 0
+                             : op == OpCode::Le ? c <= 0
+                             : op == OpCode::Gt ? c > 0
+                             : c >= 0);
+    }
+    default:
+        return Value();  // arithmetic on non-numbers
+    }
+}
+
+// =============================================================================
+// Lexer
+// =============================================================================
+
+enum class TokenKind {
+    End,
+    Number,
+    String,
+    Identifier,
+    True,
+    False,
+    Null,
+    Operator,
+    LParen,
+    RParen,
+    Invalid
+};
+
+struct Token {
+    TokenKind kind = TokenKind::End;
+    QString text;
+    double number = 0;
+    OpCode op = OpCode::Return;
+    int position = 0;
+};
+
+class Lexer
+{
+public:
+    explicit Lexer(const QString& source) : m_source(source) {}
+
+    Token next()
+    {
+        while (m_pos < m_source.size() && m_source.at(m_pos).isSpace()) {
+            ++m_pos;
+        }
+
+        Token token;
+        token.position = m_pos;
+        if (m_pos >= m_source.size()) {
+            return token;
+        }
+
+        const QChar c = m_source.at(m_pos);
+        if (c.isDigit() || (c == '.' && peek(1).isDigit())) {
+            return number(token);
+        }
+        if (c == '"' || c == '\'') {
+            return string(token, c);
+        }
+        if (c.isLetter() || c == '_') {
+            return identifier(token);
+        }
+        return punctuation(token);
+    }
+
+private:
+    QChar peek(int offset) const
+    {
+        const int i = m_pos + offset;
+        return i < m_source.size() ? m_source.at(i) : QChar();
+    }
+
+    Token number(Token& token)
+    {
+        const int start = m_pos;
+        while (m_pos < m_source.size() && (m_source.at(m_pos).isDigit() || m_source.at(m_pos) == '.')) {
+            ++m_pos;
+        }
+        if (m_pos < m_source.size() && (m_source.at(m_pos) == 'e' || m_source.at(m_pos) == 'E')) {
+            ++m_pos;
+            if (m_pos < m_source.size() && (m_source.at(m_pos) == '+' || m_source.at(m_pos) == '-')) {
+                ++m_pos;
+            }
+            while (m_pos < m_source.size() && m_source.at(m_pos).isDigit()) {
+                ++m_pos;
+            }
+        }
+
+        bool ok = false;
+        token.text = m_source.mid(start, m_pos - start);
+        token.number = token.text.toDouble(&ok);
+        token.kind = ok ? TokenKind::Number : TokenKind::Invalid;
+        return token;
+    }
+
+    Token string(Token& token, QChar quote)
+    {
+        ++m_pos;
+        while (m_pos < m_source.size() && m_source.at(m_pos) != quote) {
+            QChar c = m_source.at(m_pos++);
+            if (c == '\\' && m_pos < m_source.size()) {
+                c = m_source.at(m_pos++);
+                if (c == 'n') c = '\n';
+                else if (c == 't') c = '\t';
+            }
+            token.text.append(c);
+        }
+        if (m_pos >= m_source.size()) {
+            token.kind = TokenKind::Invalid;
+            token.text = QStringLiteral("unterminated string");
+            return token;
+        }
+        ++m_pos;
+        token.kind = TokenKind::String;
+        return token;
+    }
+
+    Token identifier(Token& token)
+    {
+        const int start = m_pos;
+        while (m_pos < m_source.size()) {
+            const QChar c = m_source.at(m_pos);
+            if (c.isLetterOrNumber() || c == '_') {
+                ++m_pos;
+            } else if (c == '.' && (peek(1).isLetter() || peek(1) == '_')) {
+                m_pos += 2;
+            } else {
+                break;
+            }
+        }
+
+        token.text = m_source.mid(start, m_pos - start);
+        token.kind = token.text == QLatin1String("true") ? TokenKind::True
+                   : token.text == QLatin1String("false") ? TokenKind::False
+                   : token.text == QLatin1String("null") ? TokenKind::Null
+                   : TokenKind::Identifier;
+        return token;
+    }
+
+    Token punctuation(Token& token)
+    {
+        struct Symbol {
+            const char* text;
+            TokenKind kind;
+            OpCode op;
+        };
+        static const Symbol symbols[] = {
+            {"&&", TokenKind::Operator, OpCode::JumpIfFalse},
+            {"||", TokenKind::Operator, OpCode::JumpIfTrue},
+            {"==", TokenKind::Operator, OpCode::Eq},
+            {"!=", TokenKind::Operator, OpCode::Ne},
+            {"<=", TokenKind::Operator, OpCode::Le},
+            {">=", TokenKind::Operator, OpCode::Ge},
+            {"<", TokenKind::Operator, OpCode::Lt},
+            {">", TokenKind::Operator, OpCode::Gt},
+            {"+", TokenKind::Operator, OpCode::Add},
+            {"-", TokenKind::Operator, OpCode::Sub},
+            {"*", TokenKind::Operator, OpCode::Mul},
+            {"/", TokenKind::Operator, OpCode::Div},
+            {"%", TokenKind::Operator, OpCode::Mod},
+            {"!", TokenKind::Operator, OpCode::Not},
+            {"(", TokenKind::LParen, OpCode::Return},
+            {")", TokenKind::RParen, OpCode::Return},
+        };
+
+        for (const Symbol& symbol : symbols) {
+            const QLatin1String text(symbol.text);
+            if (QStringView(m_source).mid(m_pos).startsWith(text)) {
+                m_pos += text.size();
+                token.kind = symbol.kind;
+                token.op = symbol.op;
+                token.text = text;
+                return token;
+            }
+        }
+
+        token.kind = TokenKind::Invalid;
+        token.text = m_source.at(m_pos);
+        ++m_pos;
+        return token;
+    }
+
+    const QString& m_source;
+    int m_pos = 0;
+};
+
+// =============================================================================
+// Syntax tree
+// =============================================================================
+
+struct Node {
+    enum Kind { Constant, Field, Unary, Binary, And, Or };
+
+    Kind kind = Constant;
+    OpCode op = OpCode::Return;
+    Value value;
+    int slot = -1;
+    std::unique_ptr<Node> lhs;
+    std::unique_ptr<Node> rhs;
+};
+
+using NodePtr = std::unique_ptr<Node>;
+
+NodePtr makeConstant(Value value)
+{
+    auto node = std::make_unique<Node>();
+    node->kind = Node::Constant;
+    node->value = std::move(value);
+    return node;
+}
+
+int precedence(OpCode op)
+{
+    switch (op) {
+    case OpCode::JumpIfTrue: return 1;     // ||
+    case OpCode::JumpIfFalse: return 2;    // &&
+    case OpCode::Eq:
+    case OpCode::Ne: return 3;
+    case OpCode::Lt:
+    case OpCode::Le:
+    case OpCode::Gt:
+    case OpCode::Ge: return 4;
+    case OpCode::Add:
+    case OpCode::Sub: return 5;
+    case OpCode::Mul:
+    case OpCode::Div:
+    case OpCode::Mod: return 6;
+    default: return 0;
+    }
+}
+
+// Folds constant subtrees; && / || with a constant left side collapse to
+// that side's decision or to a truthiness test of the right side
+NodePtr fold(NodePtr node)
+{
+    switch (node->kind) {
+    case Node::Constant:
+    case Node::Field:
+        return node;
+    case Node::Unary:
+        node->lhs = fold(std::move(node->lhs));
+        if (node->lhs->kind == Node::Constant) {
+            return makeConstant(applyUnary(node->op, node->lhs->value));
+        }
+        return node;
+    case Node::Binary:
+        node->lhs = fold(std::move(node->lhs));
+        node->rhs = fold(std::move(node->rhs));
+        if (node->lhs->kind == Node::Constant && node->rhs->kind == Node::Constant) {
+            return makeConstant(applyBinary(node->op, node->lhs->value, node->rhs->value));
+        }
+        return node;
+    case Node::And:
+    case Node::Or: {
+        node->lhs = fold(std::move(node->lhs));
+        node->rhs = fold(std::move(node->rhs));
+        if (node->lhs->kind != Node::Constant) {
+            return node;
+        }
+        const bool decided = node->lhs->value.truthy() == (node->kind == Node::Or);
+        if (decided) {
+            return makeConstant(Value::fromBool(node->kind == Node::Or));
+        }
+        if (node->rhs->kind == Node::Constant) {
+            return makeConstant(Value::fromBool(node->rhs->value.truthy()));
+        }
+        auto truthy = std::make_unique<Node>();
+        truthy->kind = Node::Unary;
+        truthy->op = OpCode::Truthy;
+        truthy->lhs = std::move(node->rhs);
+        return truthy;
+    }
+    }
+    return node;
+}
+
+// =============================================================================
+// Operand encoding
+// =============================================================================
+
+constexpr quint16 KIND_REGISTER = 0;
+constexpr quint16 KIND_CONSTANT = 1;
+constexpr quint16 KIND_FIELD = 2;
+constexpr quint16 INDEX_MASK = 0x3FFF;
+constexpr int MAX_INDEX = INDEX_MASK;
+
+constexpr quint16 operand(quint16 kind, int index)
+{
+    return static_cast<quint16>((kind << 14) | (index & INDEX_MASK));
+}
+
+const char* opName(OpCode op)
+{
+    static const char* const names[] = {
+        "truthy", "not", "neg", "add", "sub", "mul", "div", "mod",
+        "eq", "ne", "lt", "le", "gt", "ge", "jmp", "jf", "jt", "ret"
+    };
+    return names[static_cast<int>(op)];
+}
+
+} // namespace
+
+// =============================================================================
+// Value / FieldTable
+// =============================================================================
+
+Value Value::fromVariant(const QVariant& value)
+{
+    switch (value.typeId()) {
+    case QMetaType::Bool:
+        return fromBool(value.toBool());
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::Long:
+    case QMetaType::ULong:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Short:
+    case QMetaType::UShort:
+    case QMetaType::Float:
+    case QMetaType::Double:
+        return fromNumber(value.toDouble());
+    case QMetaType::QString:
+        return fromString(value.toString());
+    default:
+        if (!value.isValid() || value.isNull()) {
+            return Value();
+        }
+        return fromString(value.toString());
+    }
+}
+
+QVariant Value::toVariant() const
+{
+    switch (type) {
+    case ValueType::Bool: return number != 0;
+    case ValueType::Number: return number;
+    case ValueType::String: return string;
+    case ValueType::Null: break;
+    }
+    return QVariant();
+}
+
+bool Value::truthy() const
+{
+    switch (type) {
+    case ValueType::Bool:
+    case ValueType::Number:
+        return number != 0 && !std::isnan(number);
+    case ValueType::String:
+        return !string.isEmpty();
+    case ValueType::Null:
+        break;
+    }
+    return false;
+}
+
+int FieldTable::slot(const QString& path)
+{
+    auto it = m_slots.constFind(path);
+    if (it != m_slots.constEnd()) {
+        return it.value();
+    }
+    if (m_paths.size() > MAX_INDEX) {
+        return -1;
+    }
+    const int slot = static_cast<int>(m_paths.size());
+    m_paths.append(path);
+    m_slots.insert(path, slot);
+    return slot;
+}
+
+int FieldTable::find(const QString& path) const
+{
+    return m_slots.value(path, -1);
+}
+
+// =============================================================================
+// Parser + code generator
+// =============================================================================
+
+class Compiler
+{
+public:
+    Compiler(const QString& source, FieldTable& fields)
+        : m_lexer(source)
+        , m_fields(fields)
+    {
+        m_program = std::make_shared<Program>();
+        m_program->m_source = source;
+        advance();
+    }
+
+    CompileResult run()
+    {
+        if (m_program->m_source.size() > Program::MAX_SOURCE_LENGTH) {
+            return {nullptr, QStringLiteral("expression longer than %1 characters")
+                                 .arg(Program::MAX_SOURCE_LENGTH)};
+        }
+
+        NodePtr root = parseExpression(0);
+        if (m_error.isEmpty() && m_token.kind != TokenKind::End) {
+            fail(QStringLiteral("unexpected '%1'").arg(m_token.text));
+        }
+        if (!m_error.isEmpty()) {
+            return {nullptr, m_error};
+        }
+
+        root = fold(std::move(root));
+        const quint16 result = emit(*root);
+        m_program->m_code.push_back({OpCode::Return, 0, result, 0});
+        if (m_error.isEmpty() && m_program->m_code.size() > size_t(Program::MAX_INSTRUCTIONS)) {
+            fail(QStringLiteral("expression too large"));
+        }
+        if (!m_error.isEmpty()) {
+            return {nullptr, m_error};
+        }
+
+        auto& slots = m_program->m_fieldSlots;
+        std::sort(slots.begin(), slots.end());
+        slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+        return {m_program, QString()};
+    }
+
+private:
+    void advance() { m_token = m_lexer.next(); }
+
+    void fail(const QString& message)
+    {
+        if (m_error.isEmpty()) {
+            m_error = QStringLiteral("%1 at position %2").arg(message).arg(m_token.position + 1);
+        }
+    }
+
+    NodePtr parseExpression(int minPrecedence)
+    {
+        NodePtr lhs = parseUnary();
+        while (m_error.isEmpty() && m_token.kind == TokenKind::Operator) {
+            const OpCode op = m_token.op;
+            const int prec = precedence(op);
+            if (prec == 0 || prec <= minPrecedence) {
+                break;
+            }
+            advance();
+
+            auto node = std::make_unique<Node>();
+            node->kind = op == OpCode::JumpIfFalse ? Node::And
+                       : op == OpCode::JumpIfTrue ? Node::Or
+                       : Node::Binary;
+            node->op = op;
+            node->lhs = std::move(lhs);
+            node->rhs = parseExpression(prec);
+            lhs = std::move(node);
+        }
+        return lhs;
+    }
+
+    // Every level of parser recursion passes through here: unary operators
+    // directly, parentheses via parsePrimary() -> parseExpression()
+    NodePtr parseUnary()
+    {
+        if (m_depth >= Program::MAX_NESTING) {
+            fail(QStringLiteral("expression nested deeper than %1 levels").arg(Program::MAX_NESTING));
+            return makeConstant(Value());
+        }
+        ++m_depth;
+        NodePtr node = parseUnaryOperand();
+        --m_depth;
+        return node;
+    }
+
+    NodePtr parseUnaryOperand()
+    {
+        if (m_token.kind == TokenKind::Operator && (m_token.op == OpCode::Not || m_token.op == OpCode::Sub)) {
+            const OpCode op = m_token.op == OpCode::Not ? OpCode::Not : OpCode::Neg;
+            advance();
+            auto node = std::make_unique<Node>();
+            node->kind = Node::Unary;
+            node->op = op;
+            node->lhs = parseUnary();
+            return node;
+        }
+        return parsePrimary();
+    }
+
+    NodePtr parsePrimary()
+    {
+        const Token token = m_token;
+        switch (token.kind) {
+        case TokenKind::Number:
+            advance();
+            return makeConstant(Value::fromNumber(token.number));
+        case TokenKind::String:
+            advance();
+            return makeConstant(Value::fromString(token.text));
+        case TokenKind::True:
+        case TokenKind::False:
+            advance();
+            return makeConstant(Value::fromBool(token.kind == TokenKind::True));
+        case TokenKind::Null:
+            advance();
+            return makeConstant(Value());
+        case TokenKind::Identifier: {
+            advance();
+            auto node = std::make_unique<Node>();
+            node->kind = Node::Field;
+            node->slot = m_fields.slot(token.text);
+            if (node->slot < 0) {
+                fail(QStringLiteral("too many distinct fields"));
+            }
+            return node;
+        }
+        case TokenKind::LParen: {
+            advance();
+            NodePtr inner = parseExpression(0);
+            if (m_token.kind != TokenKind::RParen) {
+                fail(QStringLiteral("expected ')'"));
+            }
+            advance();
+            return inner;
+        }
+        case TokenKind::End:
+            fail(QStringLiteral("unexpected end of expression"));
+            break;
+        case TokenKind::Invalid:
+            fail(QStringLiteral("invalid token '%1'").arg(token.text));
+            break;
+        default:
+            fail(QStringLiteral("unexpected '%1'").arg(token.text));
+            break;
+        }
+        return makeConstant(Value());
+    }
+
+    int allocateRegister()
+    {
+        if (m_nextRegister >= Program::MAX_REGISTERS) {
+            fail(QStringLiteral("expression too deeply nested"));
+            return 0;
+        }
+        return m_nextRegister++;
+    }
+
+    quint16 constant(const Value& value)
+    {
+        auto& constants = m_program->m_constants;
+        for (size_t i = 0; i < constants.size(); ++i) {
+            if (constants[i].type == value.type && equals(constants[i], value)) {
+                return operand(KIND_CONSTANT, static_cast<int>(i));
+            }
+        }
+        if (constants.size() > size_t(MAX_INDEX)) {
+            fail(QStringLiteral("too many constants"));
+            return operand(KIND_CONSTANT, 0);
+        }
+        constants.push_back(value);
+        return operand(KIND_CONSTANT, static_cast<int>(constants.size() - 1));
+    }
+
+    // Returns the operand holding the node's value. Registers are used as
+    // a stack: a node's temporaries are released once it has its result.
+    quint16 emit(const Node& node)
+    {
+        auto& code = m_program->m_code;
+
+        switch (node.kind) {
+        case Node::Constant:
+            return constant(node.value);
+        case Node::Field:
+            m_program->m_fieldSlots.push_back(node.slot);
+            return operand(KIND_FIELD, node.slot);
+        case Node::Unary: {
+            const int base = m_nextRegister;
+            const quint16 a = emit(*node.lhs);
+            m_nextRegister = base;
+            const int dst = allocateRegister();
+            code.push_back({node.op, static_cast<quint8>(dst), a, 0});
+            return operand(KIND_REGISTER, dst);
+        }
+        case Node::Binary: {
+            const int base = m_nextRegister;
+            const quint16 a = emit(*node.lhs);
+            const quint16 b = emit(*node.rhs);
+            m_nextRegister = base;
+            const int dst = allocateRegister();
+            code.push_back({node.op, static_cast<quint8>(dst), a, b});
+            return operand(KIND_REGISTER, dst);
+        }
+        case Node::And:
+        case Node::Or: {
+            // Like Binary, the result takes the base register once the left
+            // operand is done, so a chain of && or || holds one register.
+            // The right operand may reuse it too: dst is dead until the
+            // final Truthy unless the jump was taken.
+            const int base = m_nextRegister;
+            const quint16 lhs = emit(*node.lhs);
+            m_nextRegister = base;
+            const int dst = allocateRegister();
+            const quint16 result = operand(KIND_REGISTER, dst);
+
+            code.push_back({OpCode::Truthy, static_cast<quint8>(dst), lhs, 0});
+            const size_t jump = code.size();
+            code.push_back({node.kind == Node::And ? OpCode::JumpIfFalse : OpCode::JumpIfTrue,
+                            0, result, 0});
+
+            m_nextRegister = base;
+            const quint16 rhs = emit(*node.rhs);
+            code.push_back({OpCode::Truthy, static_cast<quint8>(dst), rhs, 0});
+            m_nextRegister = dst + 1;
+            if (code.size() > size_t(Program::MAX_INSTRUCTIONS)) {
+                fail(QStringLiteral("expression too large"));  // target would not fit 16 bits
+                return result;
+            }
+            code[jump].b = static_cast<quint16>(code.size());
+            return result;
+        }
+        }
+        return constant(Value());
+    }
+
+    Lexer m_lexer;
+    FieldTable& m_fields;
+    Token m_token;
+    QString m_error;
+    std::shared_ptr<Program> m_program;
+    int m_nextRegister = 0;
+    int m_depth = 0;
+};
+
+CompileResult compile(const QString& source, FieldTable& fields)
+{
+    return Compiler(source, fields).run();
+}
+
+// =============================================================================
+// Register VM
+// =============================================================================
+
+Value Program::evaluate(const Value* fields) const
+{
+    Value registers[MAX_REGISTERS];
+
+    auto load = [&](quint16 op) -> const Value& {
+        const int index = op & INDEX_MASK;
+        switch (op >> 14) {
+        case KIND_REGISTER: return registers[index];
+        case KIND_CONSTANT: return m_constants[static_cast<size_t>(index)];
+        default: return fields[index];
+        }
+    };
+
+    const size_t size = m_code.size();
+    for (size_t pc = 0; pc < size;) {
+        const Instruction& in = m_code[pc++];
+        switch (in.op) {
+        case OpCode::Truthy:
+        case OpCode::Not:
+        case OpCode::Neg:
+            registers[in.dst] = applyUnary(in.op, load(in.a));
+            break;
+        case OpCode::Jump:
+            pc = in.b;
+            break;
+        case OpCode::JumpIfFalse:
+            if (!load(in.a).truthy()) pc = in.b;
+            break;
+        case OpCode::JumpIfTrue:
+            if (load(in.a).truthy()) pc = in.b;
+            break;
+        case OpCode::Return:
+            return load(in.a);
+        default:
+            registers[in.dst] = applyBinary(in.op, load(in.a), load(in.b));
+            break;
+        }
+    }
+    return Value();
+}
+
+QString Program::disassemble() const
+{
+    auto format = [this](quint16 op) {
+        const int index = op & INDEX_MASK;
+        switch (op >> 14) {
+        case KIND_REGISTER: return QStringLiteral("r%1").arg(index);
+        case KIND_CONSTANT: return QStringLiteral("k%1(%2)").arg(index)
+                                .arg(m_constants[static_cast<size_t>(index)].toVariant().toString());
+        default: return QStringLiteral("f%1").arg(index);
+        }
+    };
+
+    QString text;
+    for (size_t pc = 0; pc < m_code.size(); ++pc) {
+        const Instruction& in = m_code[pc];
+        QString line = QStringLiteral("%1: %2").arg(pc, 3).arg(QLatin1String(opName(in.op)), -6);
+        switch (in.op) {
+        case OpCode::Jump:
+            line += QStringLiteral(" -> %1").arg(in.b);
+            break;
+        case OpCode::JumpIfFalse:
+        case OpCode::JumpIfTrue:
+            line += QStringLiteral(" %1 -> %2").arg(format(in.a)).arg(in.b);
+            break;
+        case OpCode::Return:
+            line += QLatin1Char(' ') + format(in.a);
+            break;
+        case OpCode::Truthy:
+        case OpCode::Not:
+        case OpCode::Neg:
+            line += QStringLiteral(" r%1, %2").arg(in.dst).arg(format(in.a));
+            break;
+        default:
+            line += QStringLiteral(" r%1, %2, %3").arg(in.dst).arg(format(in.a), format(in.b));
+            break;
+        }
+        text += line + QLatin1Char('\n');
+    }
+    return text;
+}
+
+} // namespace rules::expr
@@ -1,5 +1,12 @@
 #include "rule_model.h"
 #include "rules_service.h"
+#include "rules_metrics.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
 
 namespace rules {
 
@@ -14,7 +21,10 @@ RuleModel::RuleModel(RulesService* service, QObject* parent)
     setService(service);
 }
 
-RuleModel::~RuleModel() = default;
+RuleModel::~RuleModel()
+{
+    m_pendingLoad.cancel();
+}
 
 int RuleModel::rowCount(const QModelIndex& parent) const
 {
@@ -71,13 +81,32 @@ QHash<int, QByteArray> RuleModel::roleNames() const
 
 void RuleModel::setFilterStatus(const QString& status)
 {
-    if (m_filterStatus != status) {
-        m_filterStatus = status;
+    if (m_view.filterStatus != status) {
+        m_view.filterStatus = status;
         updateFilteredRules();
         emit filterStatusChanged();
     }
 }
 
+void RuleModel::setSortBy(const QString& sortBy)
+{
+    if (m_view.sortBy != sortBy) {
+        m_view.sortBy = sortBy;
+        updateFilteredRules();
+        emit sortByChanged();
+    }
+}
+
+void RuleModel::setLimit(int limit)
+{
+    limit = qMax(0, limit);
+    if (m_view.limit != limit) {
+        m_view.limit = limit;
+        updateFilteredRules();
+        emit limitChanged();
+    }
+}
+
 void RuleModel::setService(RulesService* service)
 {
     if (m_service == service) {
@@ -113,23 +142,257 @@ QVariantMap RuleModel::get(int index) const
 
 void RuleModel::onRulesChanged()
 {
-    updateFilteredRules();
+    // A rebuild in flight catches up from its snapshot once it lands
+    if (m_loading) {
+        return;
+    }
+
+    const ChangeSet set = m_service->changesSince(m_sequence);
+
+    // Each change costs a row lookup and shift, linear in the rows, so only
+    // a few are applied in place; a burst is one rebuild, which runs off the
+    // GUI thread for large stores
+    if (set.reset || set.changes.size() > MAX_DELTA_CHANGES) {
+        updateFilteredRules();
+        return;
+    }
+
+    RULES_TRACE_SCOPE("RuleModel::applyChanges");
+    const qsizetype rows = m_filteredRules.size();
+    for (const RuleChange& change : set.changes) {
+        if (!applyChange(change)) {
+            updateFilteredRules();
+            return;
+        }
+    }
+    m_sequence = set.sequence;
+    metrics::count(RulesMetrics::counters().modelDeltas, static_cast<quint64>(set.changes.size()));
+    if (m_filteredRules.size() != rows) {
+        emit countChanged();
+    }
 }
 
 void RuleModel::updateFilteredRules()
 {
-    beginResetModel();
+    RULES_TRACE_SCOPE("RuleModel::updateFilteredRules");
+    const quint64 load = ++m_load;
+    m_pendingLoad.cancel();
 
     if (!m_service) {
-        m_filteredRules = {};
-    } else if (m_filterStatus.isEmpty()) {
-        m_filteredRules = m_service->getAllRules();
-    } else {
-        m_filteredRules = m_service->getRulesByStatus(m_filterStatus);
+        resetRows({}, 0);
+        setLoading(false);
+        return;
+    }
+
+    // "Newest N" windows come from the time index, small stores are cheap.
+    // The index is not keyed by status: a filtered window may scan all of
+    // it, so on a large store it is built on a worker like any other view.
+    const quint64 sequence = m_service->generation();
+    const bool largeStore = m_service->getRuleCount() >= ASYNC_MIN_RULES;
+    if (m_view.timeSorted() && m_view.limit > 0 && (m_view.filterStatus.isEmpty() || !largeStore)) {
+        const auto field = m_view.sortBy == QLatin1String("updatedAt")
+            ? RulesService::TimeField::UpdatedAt : RulesService::TimeField::CreatedAt;
+        resetRows(buildRows(m_service->recentRules(field, m_view.limit, m_view.filterStatus), m_view, nullptr),
+                  sequence);
+        setLoading(false);
+        return;
+    }
+    if (!largeStore) {
+        resetRows(buildRows(m_service->rules(), m_view, nullptr), sequence);
+        setLoading(false);
+        return;
+    }
+
+    setLoading(true);
+    m_pendingLoad = m_service->readAsync<Rows>([view = m_view](QPromise<Rows>& promise, const QList<Rule>& rules) {
+        Rows rows = buildRows(rules, view, &promise);
+        if (!promise.isCanceled()) {
+            promise.addResult(std::move(rows));
+        }
+    });
+    m_pendingLoad.then(this, [this, load, sequence](Rows rows) {
+        if (load != m_load) {
+            return;     // finished before a newer rebuild could cancel it
+        }
+        resetRows(std::move(rows), sequence);
+        setLoading(false);
+        if (m_service && m_service->generation() != m_sequence) {
+            onRulesChanged();   // edits made while building
+        }
+    });
+}
+
+RuleModel::Rows RuleModel::buildRows(const QList<Rule>& rules, const View& view, const QPromise<Rows>* promise)
+{
+    constexpr qsizetype CANCEL_CHECK_INTERVAL = 4096;
+    auto canceled = [promise](qsizetype i) {
+        return promise && i % CANCEL_CHECK_INTERVAL == 0 && promise->isCanceled();
+    };
+
+    // (key, index) of the shown rules; untimed views are keyed by store row,
+    // so service order is already key order
+    const bool timeSorted = view.timeSorted();
+    std::vector<std::pair<qint64, qsizetype>> order;
+    for (qsizetype i = 0; i < rules.size(); ++i) {
+        if (canceled(i)) {
+            return {};
+        }
+        if (view.accepts(rules.at(i))) {
+            order.emplace_back(timeSorted ? view.rowKey(rules.at(i)) : i, i);
+        }
+    }
+    if (timeSorted) {
+        std::stable_sort(order.begin(), order.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+        if (view.limit > 0 && order.size() > static_cast<size_t>(view.limit)) {
+            order.resize(static_cast<size_t>(view.limit));
+        }
+    }
+
+    Rows rows;
+    rows.rules.reserve(static_cast<qsizetype>(order.size()));
+    rows.ids.reserve(static_cast<qsizetype>(order.size()));
+    rows.keys.reserve(static_cast<qsizetype>(order.size()));
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (canceled(static_cast<qsizetype>(i))) {
+            return {};
+        }
+        const Rule& rule = rules.at(order[i].second);
+        rows.rules.append(rule.toVariantMap());
+        rows.ids.append(rule.id);
+        rows.keys.append(order[i].first);
     }
+    return rows;
+}
+
+void RuleModel::resetRows(Rows rows, quint64 sequence)
+{
+    beginResetModel();
+
+    m_filteredRules = std::move(rows.rules);
+    m_rowIds = std::move(rows.ids);
+    m_rowKeys = std::move(rows.keys);
+    m_sequence = sequence;
     
     endResetModel();
+    metrics::count(RulesMetrics::counters().modelResets);
     emit countChanged();
 }
 
+void RuleModel::setLoading(bool loading)
+{
+    if (m_loading != loading) {
+        m_loading = loading;
+        emit loadingChanged();
+    }
+}
+
+// False if the change cannot be applied to the rows alone: a removal
+// from a full limited window must pull in the next rule from the service
+bool RuleModel::applyChange(const RuleChange& change)
+{
+    const qsizetype row = m_rowIds.indexOf(change.rule.id);
+    const bool shown = change.kind != RuleChange::Deleted && m_view.accepts(change.rule);
+    const bool timeSorted = m_view.timeSorted();
+    const qint64 key = timeSorted ? m_view.rowKey(change.rule) : 0;
+
+    // Updates never move a rule in store order
+    if (row >= 0 && shown && (!timeSorted || m_rowKeys.at(row) == key)) {
+        m_filteredRules[row] = change.rule.toVariantMap();
+        const QModelIndex changed = index(static_cast<int>(row));
+        emit dataChanged(changed, changed);
+        return true;
+    }
+
+    const bool limited = timeSorted && m_view.limit > 0;
+    const bool full = limited && m_filteredRules.size() >= m_view.limit;
+    if (row >= 0) {
+        removeRow(row);
+    }
+    if (!shown) {
+        return row < 0 || !full;
+    }
+
+    if (!timeSorted) {
+        const qsizetype storeRow = m_service->rowOf(change.rule.id);
+        if (storeRow < 0) {
+            return true;    // deleted by a later change of this batch
+        }
+        const qsizetype at = storeOrderRow(storeRow);
+        if (at < 0) {
+            return false;
+        }
+        insertRow(at, change.rule, storeRow);
+        return true;
+    }
+
+    // Rows are ascending by key; equal keys keep arrival order
+    const qsizetype at = std::upper_bound(m_rowKeys.cbegin(), m_rowKeys.cend(), key) - m_rowKeys.cbegin();
+    if (limited && at >= m_view.limit) {
+        return row < 0 || !full;    // falls outside the window
+    }
+    insertRow(at, change.rule, key);
+    if (limited && m_filteredRules.size() > m_view.limit) {
+        removeRow(m_filteredRules.size() - 1);
+    }
+    return true;
+}
+
+// Store rows shift on deletion, so untimed views locate a row by binary
+// search over the shown rules' current store rows. -1 if a shown rule has
+// left the store (its deletion is still ahead in the batch).
+qsizetype RuleModel::storeOrderRow(qsizetype storeRow) const
+{
+    qsizetype low = 0;
+    qsizetype high = m_rowIds.size();
+    while (low < high) {
+        const qsizetype mid = low + (high - low) / 2;
+        const qsizetype midRow = m_service->rowOf(m_rowIds.at(mid));
+        if (midRow < 0) {
+            return -1;
+        }
+        if (midRow < storeRow) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+void RuleModel::insertRow(qsizetype row, const Rule& rule, qint64 key)
+{
+    beginInsertRows(QModelIndex(), static_cast<int>(row), static_cast<int>(row));
+    m_filteredRules.insert(row, rule.toVariantMap());
+    m_rowIds.insert(row, rule.id);
+    m_rowKeys.insert(row, key);
+    endInsertRows();
+}
+
+void RuleModel::removeRow(qsizetype row)
+{
+    beginRemoveRows(QModelIndex(), static_cast<int>(row), static_cast<int>(row));
+    m_filteredRules.removeAt(row);
+    m_rowIds.removeAt(row);
+    m_rowKeys.removeAt(row);
+    endRemoveRows();
+}
+
+bool RuleModel::View::accepts(const Rule& rule) const
+{
+    return filterStatus.isEmpty() || rule.status == filterStatus;
+}
+
+bool RuleModel::View::timeSorted() const
+{
+    return sortBy == QLatin1String("createdAt") || sortBy == QLatin1String("updatedAt");
+}
+
+qint64 RuleModel::View::rowKey(const Rule& rule) const
+{
+    // Newest first; untimed views follow store order instead
+    const qint64 ms = TimeIndex::key(sortBy == QLatin1String("updatedAt") ? rule.updatedAt : rule.createdAt);
+    return ms == std::numeric_limits<qint64>::min() ? std::numeric_limits<qint64>::max() : -ms;
+}
+
 } // namespace rules
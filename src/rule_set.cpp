@@ -0,0 +1,53 @@
+#include "rule_set.h"
+#include "epoch.h"
+
+#include <algorithm>
+
+namespace rules {
+
+std::unique_ptr<CompiledRuleSet> CompiledRuleSet::build(quint64 version,
+                                                        const QHash<QString, CompiledRule>& rules,
+                                                        const expr::FieldTable& fields)
+{
+    auto set = std::make_unique<CompiledRuleSet>();
+    set->version = version;
+    set->fields = fields;
+
+    set->rules.reserve(static_cast<size_t>(rules.size()));
+    for (const CompiledRule& rule : rules) {
+        set->rules.push_back(rule);
+        const auto& slots = rule.program->fieldSlots();
+        set->fieldSlots.insert(set->fieldSlots.end(), slots.begin(), slots.end());
+    }
+
+    // Deterministic evaluation order regardless of hash iteration order
+    std::sort(set->rules.begin(), set->rules.end(),
+              [](const CompiledRule& a, const CompiledRule& b) { return a.id < b.id; });
+
+    auto& slots = set->fieldSlots;
+    std::sort(slots.begin(), slots.end());
+    slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+    return set;
+}
+
+RuleSetSlot::RuleSetSlot()
+    : m_current(new CompiledRuleSet())
+{
+}
+
+RuleSetSlot::~RuleSetSlot()
+{
+    delete m_current.load();
+    epoch::collect();
+}
+
+void RuleSetSlot::publish(std::unique_ptr<CompiledRuleSet> set)
+{
+    const CompiledRuleSet* previous = m_current.exchange(set.release(), std::memory_order_seq_cst);
+    m_swaps.fetch_add(1, std::memory_order_relaxed);
+
+    epoch::retire(previous);
+    epoch::collect();
+}
+
+} // namespace rules
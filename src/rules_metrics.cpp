@@ -0,0 +1,128 @@
+#include "rules_metrics.h"
+
+#include <mpf/interfaces/ieventbus.h>
+
+#include <algorithm>
+
+namespace rules {
+
+RulesMetrics::RulesMetrics(const QString& pluginId, QObject* parent)
+    : QObject(parent)
+    , m_pluginId(pluginId)
+{
+    bool ok = false;
+    int interval = qEnvironmentVariableIntValue("MPF_RULES_METRICS_INTERVAL_MS", &ok);
+    if (ok) {
+        m_publishIntervalMs = interval;
+    }
+
+    connect(&m_timer, &QTimer::timeout, this, &RulesMetrics::tick);
+    m_sinceLastTick.start();
+}
+
+RulesMetrics::~RulesMetrics() = default;
+
+MetricCounters& RulesMetrics::counters()
+{
+    static MetricCounters instance;
+    return instance;
+}
+
+QVariantMap RulesMetrics::snapshot() const
+{
+    const MetricCounters& c = counters();
+    auto load = [](const auto& value) { return value.load(std::memory_order_relaxed); };
+
+    // Candidate evaluation cost relative to the active set on the same events
+    const quint64 shadowActiveNs = load(c.shadowActiveNs);
+    const double shadowCostRatio = shadowActiveNs > 0
+        ? static_cast<double>(load(c.shadowCandidateNs)) / shadowActiveNs : 0.0;
+
+    const quint64 memoHits = load(c.memoHits);
+    const quint64 memoLookups = memoHits + load(c.memoMisses);
+    const double memoHitRate = memoLookups > 0 ? static_cast<double>(memoHits) / memoLookups : 0.0;
+
+    return {
+        {"mutations", load(c.mutations)},
+        {"mutationsPerSecond", m_mutationsPerSecond},
+        {"rulesChangedEmitted", load(c.rulesChangedEmitted)},
+        {"modelResets", load(c.modelResets)},
+        {"modelDeltas", load(c.modelDeltas)},
+        {"changeFeedResets", load(c.changeFeedResets)},
+        {"eventsReceived", load(c.eventsReceived)},
+        {"eventsPerSecond", m_eventsPerSecond},
+        {"eventsFiltered", load(c.eventsFiltered)},
+        {"eventsDropped", load(c.eventsDropped)},
+        {"eventsShed", load(c.eventsShed)},
+        {"eventsExpired", load(c.eventsExpired)},
+        {"eventsQueued", load(c.eventsQueued)},
+        {"messageQueueDepth", load(c.messageQueueDepth)},
+        {"httpQueued", load(c.httpQueued)},
+        {"httpInFlight", load(c.httpInFlight)},
+        {"ruleCount", load(c.ruleCount)},
+        {"orderEvents", load(c.orderEvents)},
+        {"windowKeys", load(c.windowKeys)},
+        {"windowKeysEvicted", load(c.windowKeysEvicted)},
+        {"correlatedOrders", load(c.correlatedOrders)},
+        {"correlationHits", load(c.correlationHits)},
+        {"correlationMisses", load(c.correlationMisses)},
+        {"conditionsEvaluated", load(c.conditionsEvaluated)},
+        {"conditionsMatched", load(c.conditionsMatched)},
+        {"resultBatches", load(c.resultBatches)},
+        {"resultsPublished", load(c.resultsPublished)},
+        {"memoHits", memoHits},
+        {"memoHitRate", memoHitRate},
+        {"memoSavedMs", load(c.memoSavedNs) / 1e6},
+        {"shadowEvaluated", load(c.shadowEvaluated)},
+        {"shadowDivergent", load(c.shadowDivergent)},
+        {"shadowShed", load(c.shadowShed)},
+        {"shadowCostRatio", shadowCostRatio},
+        {"logRecordsDropped", load(c.logRecordsDropped)}
+    };
+}
+
+void RulesMetrics::setPublishIntervalMs(int intervalMs)
+{
+    if (m_publishIntervalMs == intervalMs) {
+        return;
+    }
+
+    m_publishIntervalMs = intervalMs;
+    if (m_eventBus && m_publishIntervalMs > 0) {
+        m_timer.start(m_publishIntervalMs);
+    } else {
+        m_timer.stop();
+    }
+    emit publishIntervalMsChanged();
+}
+
+void RulesMetrics::setEventBus(mpf::IEventBus* eventBus)
+{
+    m_eventBus = eventBus;
+    if (m_eventBus && m_publishIntervalMs > 0) {
+        m_timer.start(m_publishIntervalMs);
+    } else {
+        m_timer.stop();
+    }
+}
+
+void RulesMetrics::tick()
+{
+    const MetricCounters& c = counters();
+    const quint64 mutations = c.mutations.load(std::memory_order_relaxed);
+    const quint64 events = c.eventsReceived.load(std::memory_order_relaxed);
+    const double seconds = std::max<qint64>(m_sinceLastTick.restart(), 1) / 1000.0;
+
+    m_mutationsPerSecond = (mutations - m_lastMutations) / seconds;
+    m_eventsPerSecond = (events - m_lastEventsReceived) / seconds;
+    m_lastMutations = mutations;
+    m_lastEventsReceived = events;
+
+    emit snapshotChanged();
+
+    if (m_eventBus) {
+        m_eventBus->publish("rules/metrics", snapshot(), m_pluginId);
+    }
+}
+
+} // namespace rules
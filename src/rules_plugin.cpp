@@ -2,19 +2,89 @@
 #include "rules_service.h"
 #include "rule_model.h"
 #include "demo_service.h"
+#include "rule_engine.h"
+#include "event_scheduler.h"
+#include "rules_metrics.h"
+#include "rules_service_api.h"
+#include "trace.h"
+#include "plugin_log.h"
 
 #include <mpf/service_registry.h>
 #include <mpf/interfaces/inavigation.h>
 #include <mpf/interfaces/imenu.h>
 #include <mpf/interfaces/ieventbus.h>
-#include <mpf/logger.h>
 
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QJsonDocument>
 #include <QQmlEngine>
-#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
 
 namespace rules {
 
+namespace {
+
+// Handoff header ahead of the rule snapshot: the writer's pid and the time
+// of writing. Only a blob this process wrote moments ago is a hot reload;
+// anything else is a leftover from an earlier run or another process.
+constexpr quint32 HANDOFF_MAGIC = 0x52484831;  // "RHH1"
+constexpr qint64 HANDOFF_MAX_AGE_MS = 60 * 1000;
+
+QString handoffPath()
+{
+    QString path = qEnvironmentVariable("MPF_RULES_HANDOFF_FILE");
+    if (path.isEmpty()) {
+        // Per-user location rather than the shared temp directory
+        QString dir = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+        if (dir.isEmpty()) {
+            dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+        }
+        QDir().mkpath(dir);
+        path = QDir(dir).filePath("mpf-rules-handoff.bin");
+    }
+    return path;
+}
+
+bool writeHandoffHeader(QIODevice* device)
+{
+    QDataStream out(device);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << HANDOFF_MAGIC << static_cast<qint64>(QCoreApplication::applicationPid())
+        << QDateTime::currentMSecsSinceEpoch();
+    return out.status() == QDataStream::Ok;
+}
+
+// Empty if the header belongs to this process and is fresh, else why not
+QString checkHandoffHeader(QIODevice* device)
+{
+    QDataStream in(device);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    qint64 pid = 0;
+    qint64 writtenMs = 0;
+    in >> magic >> pid >> writtenMs;
+    if (in.status() != QDataStream::Ok || magic != HANDOFF_MAGIC) {
+        return "unreadable";
+    }
+    if (pid != QCoreApplication::applicationPid()) {
+        return QString("written by another process (pid %1)").arg(pid);
+    }
+    const qint64 ageMs = QDateTime::currentMSecsSinceEpoch() - writtenMs;
+    if (ageMs < 0 || ageMs > HANDOFF_MAX_AGE_MS) {
+        return QString("stale (%1 ms old)").arg(ageMs);
+    }
+    return QString();
+}
+
+} // namespace
+
 RulesPlugin::RulesPlugin(QObject* parent)
     : QObject(parent)
 {
@@ -24,74 +94,93 @@ RulesPlugin::~RulesPlugin() = default;
 
 bool RulesPlugin::initialize(mpf::ServiceRegistry* registry)
 {
+    RULES_TRACE_SCOPE("RulesPlugin::initialize");
     m_registry = registry;
-    
-    MPF_LOG_INFO("RulesPlugin", "Initializing...");
-    
-    // 调试：检查 qrc 资源是否可访问
-    QStringList resourcesToCheck = {
-        ":/Biiz/Rules/RulesPage.qml",
-        "qrc:/Biiz/Rules/RulesPage.qml"
-    };
-    for (const QString& res : resourcesToCheck) {
-        QFile f(res);
-        MPF_LOG_DEBUG("RulesPlugin",
-            QString("Resource check: %1 exists=%2").arg(res).arg(f.exists() ? "YES" : "NO").toStdString().c_str());
+    log::open();    // a previous instance's stop() closed the sink
+
+    QElapsedTimer timer;
+    timer.start();
+
+    RULES_LOG_INFO("RulesPlugin", "Initializing...");
+
+    // Lazy activation is the default: services (and the HTTP stack behind
+    // DemoService) are only built when a page or an event first needs them.
+    m_lazyActivation = !qEnvironmentVariableIsSet("MPF_RULES_EAGER_INIT");
+
+    // Metrics are cheap and should cover activation itself, so never deferred
+    m_metrics = std::make_unique<RulesMetrics>("com.biiz.rules", this);
+    if (!m_lazyActivation) {
+        createServices();
     }
-    
-    // Create and register our service
-    m_rulesService = std::make_unique<RulesService>(this);
 
-    // Demo service for framework showcase
-    m_demoService = std::make_unique<DemoService>("com.biiz.rules", this);
+    // Typed interface for other plugins; activates the services on first call
+    m_api = std::make_unique<RulesServiceApi>(this, [this]() {
+        activate("IRulesService call");
+        return m_rulesService.get();
+    });
+    m_registry->add<IRulesService>(m_api.get(), IRulesService::apiVersion, "com.biiz.rules");
 
     // Register QML types
     registerQmlTypes();
-    
-    MPF_LOG_INFO("RulesPlugin", "Initialized successfully");
+
+    m_startupNs += timer.nsecsElapsed();
+    RULES_LOG_INFO("RulesPlugin", "Initialized successfully");
     return true;
 }
 
 bool RulesPlugin::start()
 {
-    MPF_LOG_INFO("RulesPlugin", "Starting...");
+    RULES_TRACE_SCOPE("RulesPlugin::start");
+    QElapsedTimer timer;
+    timer.start();
+
+    RULES_LOG_INFO("RulesPlugin", "Starting...");
     
     // Register routes with navigation service
     registerRoutes();
 
-    // Connect DemoService to EventBus for cross-plugin messaging
-    auto* eventBus = m_registry->get<mpf::IEventBus>();
-    if (eventBus) {
-        auto* eventBusObj = dynamic_cast<QObject*>(eventBus);
-        if (eventBusObj) {
-            m_demoService->connectToEventBus(eventBusObj, "demo/rules/");
-        }
+    // Periodic snapshots on rules/metrics
+    m_metrics->setEventBus(m_registry->get<mpf::IEventBus>());
+
+    if (m_lazyActivation) {
+        watchEventBus();
+    } else {
+        connectServices();
+        loadInitialData();
     }
 
-    // Add some sample data for demo
-    m_rulesService->createRule({
-        {"customerName", "Rule A"},
-        {"productName", "Validation Rule"},
-        {"quantity", 1},
-        {"price", 0},
-        {"status", "active"}
-    });
-    
-    m_rulesService->createRule({
-        {"customerName", "Rule B"},
-        {"productName", "Approval Rule"},
-        {"quantity", 1},
-        {"price", 0},
-        {"status", "active"}
-    });
-    
-    MPF_LOG_INFO("RulesPlugin", "Started with sample rules");
+    m_startupNs += timer.nsecsElapsed();
+    RULES_LOG_INFO("RulesPlugin", "Started in %1 ms (initialize + start, %2)",
+                   QString::number(m_startupNs / 1e6, 'f', 2),
+                   QString(m_lazyActivation ? "services deferred until first use" : "eager"));
     return true;
 }
 
 void RulesPlugin::stop()
 {
-    MPF_LOG_INFO("RulesPlugin", "Stopping...");
+    {
+        RULES_TRACE_SCOPE("RulesPlugin::stop");
+        RULES_LOG_INFO("RulesPlugin", "Stopping...");
+        // Other plugins must not reach this instance once it is stopping
+        m_registry->remove<IRulesService>();
+        m_api->shutdown();
+        stopWatchingEventBus();
+        m_metrics->setEventBus(nullptr);
+        saveHandoff();
+    }
+
+#if defined(RULES_TRACING)
+    const QString tracePath = qEnvironmentVariable("MPF_RULES_TRACE_FILE");
+    if (!tracePath.isEmpty()) {
+        bool written = trace::exportChromeJson(tracePath);
+        RULES_LOG_INFO("RulesPlugin", "Trace export to %1: %2",
+                       tracePath, QString(written ? "ok" : "failed"));
+    }
+#endif
+
+    // Drain queued records and join the sink before the library can unload;
+    // whatever still logs (scheduler, shadow pool) now logs synchronously
+    log::shutdown();
 }
 
 QJsonObject RulesPlugin::metadata() const
@@ -105,7 +194,7 @@ QJsonObject RulesPlugin::metadata() const
         "requires": [
             {"type": "service", "id": "INavigation", "min": "1.0"}
         ],
-        "provides": ["RulesService"],
+        "provides": ["RulesService", "IRulesService"],
         "qmlModules": ["Biiz.Rules"],
         "priority": 20
     })").object();
@@ -113,14 +202,15 @@ QJsonObject RulesPlugin::metadata() const
 
 void RulesPlugin::registerRoutes()
 {
+    RULES_TRACE_SCOPE("RulesPlugin::registerRoutes");
     auto* nav = m_registry->get<mpf::INavigation>();
     if (nav) {
         // QML 文件统一从 qrc 资源加载（由 qt_add_qml_module 嵌入 DLL）
         nav->registerRoute("rules", "qrc:/Biiz/Rules/RulesPage.qml");
-        MPF_LOG_INFO("RulesPlugin", "Registered route: rules (qrc)");
+        RULES_LOG_INFO("RulesPlugin", "Registered route: rules (qrc)");
 
         nav->registerRoute("rules-demo", "qrc:/Biiz/Rules/DemoPage.qml");
-        MPF_LOG_INFO("RulesPlugin", "Registered route: rules-demo (qrc)");
+        RULES_LOG_INFO("RulesPlugin", "Registered route: rules-demo (qrc)");
     }
     
     // Register menu item
@@ -137,19 +227,14 @@ void RulesPlugin::registerRoutes()
         
         bool registered = menu->registerItem(item);
         if (!registered) {
-            MPF_LOG_WARNING("RulesPlugin", "Failed to register menu item");
+            RULES_LOG_WARNING("RulesPlugin", "Failed to register menu item");
             return;
         }
         
-        // Update badge with rule count
-        menu->setBadge("rules", QString::number(m_rulesService->getRuleCount()));
-        
-        // Connect to update badge when rules change
-        connect(m_rulesService.get(), &RulesService::rulesChanged, this, [this, menu]() {
-            menu->setBadge("rules", QString::number(m_rulesService->getRuleCount()));
-        });
-        
-        MPF_LOG_DEBUG("RulesPlugin", "Registered menu item");
+        // Rule count badge is attached in connectServices()
+        m_menu = menu;
+
+        RULES_LOG_DEBUG("RulesPlugin", "Registered menu item");
 
         // Register demo menu item
         mpf::MenuItem demoItem;
@@ -162,22 +247,259 @@ void RulesPlugin::registerRoutes()
         demoItem.group = "Demo";
         menu->registerItem(demoItem);
     } else {
-        MPF_LOG_WARNING("RulesPlugin", "Menu service not available");
+        RULES_LOG_WARNING("RulesPlugin", "Menu service not available");
     }
 }
 
 void RulesPlugin::registerQmlTypes()
 {
-    // Register service as singleton (using Biiz.Rules URI)
-    qmlRegisterSingletonInstance("Biiz.Rules", 1, 0, "RulesService", m_rulesService.get());
+    RULES_TRACE_SCOPE("RulesPlugin::registerQmlTypes");
+    // Singletons are created through factories so the services are only
+    // constructed when QML first touches them (i.e. on first navigation)
+    qmlRegisterSingletonType<RulesService>("Biiz.Rules", 1, 0, "RulesService",
+        [this](QQmlEngine*, QJSEngine*) -> QObject* {
+            activate("RulesService singleton");
+            QJSEngine::setObjectOwnership(m_rulesService.get(), QJSEngine::CppOwnership);
+            return m_rulesService.get();
+        });
     
     // Register model
     qmlRegisterType<RuleModel>("Biiz.Rules", 1, 0, "RuleModel");
 
     // Register DemoService singleton for QML
-    qmlRegisterSingletonInstance("Biiz.Rules", 1, 0, "DemoService", m_demoService.get());
+    qmlRegisterSingletonType<DemoService>("Biiz.Rules", 1, 0, "DemoService",
+        [this](QQmlEngine*, QJSEngine*) -> QObject* {
+            activate("DemoService singleton");
+            QJSEngine::setObjectOwnership(m_demoService.get(), QJSEngine::CppOwnership);
+            return m_demoService.get();
+        });
+
+    // Metrics singleton exists from initialize() on
+    qmlRegisterSingletonInstance("Biiz.Rules", 1, 0, "RulesMetrics", m_metrics.get());
+
+    RULES_LOG_DEBUG("RulesPlugin", "Registered QML types");
+}
+
+void RulesPlugin::createServices()
+{
+    // Create and register our service
+    m_rulesService = std::make_unique<RulesService>(this);
+
+    // Demo service for framework showcase
+    m_demoService = std::make_unique<DemoService>("com.biiz.rules", this);
+
+    // Windowed per-customer state over orders/* events
+    m_ruleEngine = std::make_unique<RuleEngine>("com.biiz.rules", this);
+
+    // Incoming events are queued by priority class and shed under overload:
+    // orders/created checks may take room from any other traffic
+    m_scheduler = std::make_unique<EventScheduler>("com.biiz.rules", this);
+    m_scheduler->addClass({"orderChecks", {"orders/created"}, 0, 10000, 0,
+                           ShedPolicy::DropLowestPriority});
+    // Correlation state updates never expire: late is better than an order
+    // that stays joined (or keeps a stale status) until its TTL
+    m_scheduler->addClass({"orderState", {"orders/status_changed", "orders/deleted"}, 1, 5000, 0,
+                           ShedPolicy::DropOldest});
+    m_scheduler->addClass({"orders", {"orders/"}, 1, 5000, 2000, ShedPolicy::DropOldest});
+    m_scheduler->addClass({"demo", {"demo/rules/"}, 2, 1000, 5000, ShedPolicy::Sample, 10});
+
+    const QString recordPath = qEnvironmentVariable("MPF_RULES_RECORD_FILE");
+    if (!recordPath.isEmpty()) {
+        m_demoService->startRecording(recordPath);
+    }
+}
+
+void RulesPlugin::connectServices()
+{
+    // Connect DemoService to EventBus for cross-plugin messaging
+    auto* eventBus = m_registry->get<mpf::IEventBus>();
+    m_scheduler->connectToEventBus(eventBus);
+    // Recordings capture arrivals, before shedding, so a replay can
+    // reproduce an overload
+    connect(m_scheduler.get(), &EventScheduler::eventArrived,
+            m_demoService.get(), &DemoService::recordEvent);
+    connect(m_scheduler.get(), &EventScheduler::eventDispatched,
+            m_demoService.get(), &DemoService::onEventReceived);
+    connect(m_scheduler.get(), &EventScheduler::eventDispatched,
+            m_ruleEngine.get(), &RuleEngine::onEventReceived);
+    if (eventBus) {
+        auto* eventBusObj = dynamic_cast<QObject*>(eventBus);
+        if (eventBusObj) {
+            m_demoService->connectToEventBus(eventBusObj, "demo/rules/");
+        }
+    }
+
+    // Rule conditions are checked against orders/created traffic
+    m_ruleEngine->setRulesService(m_rulesService.get());
+    m_ruleEngine->connectToEventBus(eventBus);
+
+    if (m_menu) {
+        // Update badge with rule count
+        m_menu->setBadge("rules", QString::number(m_rulesService->getRuleCount()));
+
+        // Connect to update badge when rules change
+        connect(m_rulesService.get(), &RulesService::rulesChanged, this, [this]() {
+            m_menu->setBadge("rules", QString::number(m_rulesService->getRuleCount()));
+        });
+    }
+}
+
+void RulesPlugin::loadInitialData()
+{
+    RULES_TRACE_SCOPE("RulesPlugin::loadInitialData");
+
+    // A previous instance's stop() left its rules behind: adopt them as-is
+    if (adoptHandoff()) {
+        return;
+    }
+
+    // Add some sample data for demo
+    m_rulesService->createRule({
+        {"customerName", "Rule A"},
+        {"productName", "Validation Rule"},
+        {"quantity", 1},
+        {"price", 0},
+        {"status", "active"}
+    });
+    
+    m_rulesService->createRule({
+        {"customerName", "Rule B"},
+        {"productName", "Approval Rule"},
+        {"quantity", 1},
+        {"price", 0},
+        {"status", "active"}
+    });
+
+    RULES_LOG_INFO("RulesPlugin", "Loaded sample rules");
+}
+
+void RulesPlugin::saveHandoff()
+{
+    // Never activated: nothing to hand off, and an unadopted blob from an
+    // earlier instance must survive for the next one
+    if (!m_rulesService || qEnvironmentVariable("MPF_RULES_HANDOFF") == "0") {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QSaveFile file(handoffPath());
+    if (!file.open(QIODevice::WriteOnly) || !writeHandoffHeader(&file)
+        || !m_rulesService->writeSnapshot(&file) || !file.commit()) {
+        RULES_LOG_WARNING("RulesPlugin", "Failed to write handoff to %1", file.fileName());
+        return;
+    }
+
+    RULES_LOG_INFO("RulesPlugin", "Handoff: saved %1 rules in %2 ms",
+                   m_rulesService->getRuleCount(), QString::number(timer.nsecsElapsed() / 1e6, 'f', 2));
+}
+
+bool RulesPlugin::adoptHandoff()
+{
+    if (qEnvironmentVariable("MPF_RULES_HANDOFF") == "0") {
+        return false;
+    }
+
+    QFile file(handoffPath());
+    if (!file.exists()) {
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QString rejection = file.open(QIODevice::ReadOnly) ? checkHandoffHeader(&file) : QString("unreadable");
+    if (rejection.isEmpty() && !m_rulesService->readSnapshot(&file)) {
+        rejection = "unreadable";
+    }
+    file.close();
+    file.remove();  // one-shot: a blob is adopted (or discarded) exactly once
+
+    if (!rejection.isEmpty()) {
+        RULES_LOG_WARNING("RulesPlugin", "Discarded handoff blob: %1", rejection);
+        return false;
+    }
+
+    RULES_LOG_INFO("RulesPlugin", "Handoff: adopted %1 rules in %2 ms",
+                   m_rulesService->getRuleCount(), QString::number(timer.nsecsElapsed() / 1e6, 'f', 2));
+    return true;
+}
+
+void RulesPlugin::activate(const char* trigger)
+{
+    if (m_rulesService) {
+        return;
+    }
+
+    RULES_TRACE_SCOPE("RulesPlugin::activate");
+    QElapsedTimer timer;
+    timer.start();
+
+    createServices();
+    connectServices();
+    stopWatchingEventBus();
+
+    // Seed data on the next event loop pass, not inside the QML
+    // singleton factory or EventBus delivery that triggered activation
+    QTimer::singleShot(0, this, &RulesPlugin::loadInitialData);
+
+    RULES_LOG_INFO("RulesPlugin", "Activated by %1 in %2 ms (deferred from host startup)",
+                   QString(trigger), QString::number(timer.nsecsElapsed() / 1e6, 'f', 2));
+}
+
+void RulesPlugin::watchEventBus()
+{
+    auto* eventBus = m_registry->get<mpf::IEventBus>();
+    m_eventBusObj = eventBus ? dynamic_cast<QObject*>(eventBus) : nullptr;
+    if (!m_eventBusObj) {
+        return;
+    }
+
+    // Same signal DemoService listens on; the pattern subscription makes the
+    // bus emit it for our topics until the real subscriber takes over
+    connect(m_eventBusObj, SIGNAL(eventPublished(QString,QVariantMap,QString)),
+            this, SLOT(onEventBusActivity(QString,QVariantMap,QString)));
+    for (const char* pattern : {"demo/rules/**", "orders/**"}) {
+        QString subId;
+        QMetaObject::invokeMethod(m_eventBusObj, "subscribeSimple",
+            Q_RETURN_ARG(QString, subId),
+            Q_ARG(QString, QString(pattern)),
+            Q_ARG(QString, QString("com.biiz.rules.activation")));
+        if (!subId.isEmpty()) {
+            m_activationSubIds.append(subId);
+        }
+    }
+}
+
+void RulesPlugin::stopWatchingEventBus()
+{
+    if (!m_eventBusObj) {
+        return;
+    }
+
+    disconnect(m_eventBusObj, SIGNAL(eventPublished(QString,QVariantMap,QString)),
+               this, SLOT(onEventBusActivity(QString,QVariantMap,QString)));
+    for (const QString& subId : std::as_const(m_activationSubIds)) {
+        QMetaObject::invokeMethod(m_eventBusObj, "unsubscribe",
+            Q_ARG(QString, subId));
+    }
+    m_activationSubIds.clear();
+    m_eventBusObj = nullptr;
+}
+
+void RulesPlugin::onEventBusActivity(const QString& topic, const QVariantMap& data,
+                                     const QString& senderId)
+{
+    const bool demoTopic = topic.startsWith("demo/rules/");
+    if ((!demoTopic && !topic.startsWith("orders/")) || senderId == "com.biiz.rules") {
+        return;
+    }
+
+    activate("EventBus event");
 
-    MPF_LOG_DEBUG("RulesPlugin", "Registered QML types");
+    // The scheduler connected during this emission, so it misses this event
+    m_scheduler->submit(topic, data, senderId);
 }
 
 } // namespace rules
@@ -1,7 +1,15 @@
 #include "rules_service.h"
+#include "rule_bulk_io.h"
+#include "rules_metrics.h"
+#include "trace.h"
+#include "plugin_log.h"
 #include <QUuid>
 #include <QDateTime>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrentRun>
 #include <algorithm>
+#include <iterator>
 
 namespace rules {
 
@@ -18,6 +26,7 @@ QVariantMap Rule::toVariantMap() const
         {"status", status},
         {"createdAt", createdAt},
         {"updatedAt", updatedAt},
+        {"condition", condition},
         {"total", quantity * price}
     };
 }
@@ -33,6 +42,7 @@ Rule Rule::fromVariantMap(const QVariantMap& map)
     rule.status = map.value("status", "pending").toString();
     rule.createdAt = map.value("createdAt").toDateTime();
     rule.updatedAt = map.value("updatedAt").toDateTime();
+    rule.condition = map.value("condition").toString();
     return rule;
 }
 
@@ -40,10 +50,23 @@ Rule Rule::fromVariantMap(const QVariantMap& map)
 
 RulesService::RulesService(QObject* parent)
     : QObject(parent)
+    , m_ruleSets(std::make_unique<RuleSetSlot>())
+    , m_candidateSets(std::make_unique<RuleSetSlot>())
 {
+    RULES_TRACE_SCOPE("RulesService::RulesService");
+
+    bool ok = false;
+    const int changeLog = qEnvironmentVariableIntValue("MPF_RULES_CHANGE_LOG", &ok);
+    if (ok) {
+        setChangeLogCapacity(changeLog);
+    }
 }
 
-RulesService::~RulesService() = default;
+RulesService::~RulesService()
+{
+    // The builder publishes into m_ruleSets / m_candidateSets
+    m_buildFuture.waitForFinished();
+}
 
 QVariantList RulesService::getAllRules() const
 {
@@ -56,11 +79,9 @@ QVariantList RulesService::getAllRules() const
 
 QVariantMap RulesService::getRule(const QString& id) const
 {
-    auto it = std::find_if(m_rules.begin(), m_rules.end(),
-        [&id](const Rule& o) { return o.id == id; });
-    
-    if (it != m_rules.end()) {
-        return it->toVariantMap();
+    const Rule* rule = findRule(id);
+    if (rule) {
+        return rule->toVariantMap();
     }
     return {};
 }
@@ -68,61 +89,190 @@ QVariantMap RulesService::getRule(const QString& id) const
 QString RulesService::createRule(const QVariantMap& data)
 {
     Rule rule = Rule::fromVariantMap(data);
-    rule.id = generateId();
+    do {
+        rule.id = generateId();
+    } while (m_rowById.contains(rule.id));
     rule.createdAt = QDateTime::currentDateTime();
     rule.updatedAt = rule.createdAt;
     
     if (rule.status.isEmpty()) {
         rule.status = "pending";
     }
+
+    if (!compileCondition(rule)) {
+        return QString();
+    }
     
+    internStrings(rule);
+    m_rowById.insert(rule.id, m_rules.size());
     m_rules.append(rule);
+    indexTimes(rule);
+    if (indexCondition(rule)) {
+        scheduleRuleSetBuild();
+    }
     
+    recordChange(RuleChange::Created, rule);
     emit ruleCreated(rule.id);
-    emit rulesChanged();
+    notifyRulesChanged();
     
     return rule.id;
 }
 
 bool RulesService::updateRule(const QString& id, const QVariantMap& data)
 {
-    auto it = std::find_if(m_rules.begin(), m_rules.end(),
-        [&id](const Rule& o) { return o.id == id; });
-    
-    if (it == m_rules.end()) {
+    Rule* rule = findRule(id);
+    if (!rule) {
         return false;
     }
+
+    // Compile first so a bad condition leaves the rule untouched
+    if (data.contains("condition")) {
+        Rule candidate;
+        candidate.condition = data["condition"].toString();
+        if (!compileCondition(candidate)) {
+            return false;
+        }
+        rule->condition = candidate.condition;
+        rule->program = candidate.program;
+    }
     
-    if (data.contains("customerName")) it->customerName = data["customerName"].toString();
-    if (data.contains("productName")) it->productName = data["productName"].toString();
-    if (data.contains("quantity")) it->quantity = data["quantity"].toInt();
-    if (data.contains("price")) it->price = data["price"].toDouble();
-    if (data.contains("status")) it->status = data["status"].toString();
-    it->updatedAt = QDateTime::currentDateTime();
+    if (data.contains("customerName")) rule->customerName = data["customerName"].toString();
+    if (data.contains("productName")) rule->productName = data["productName"].toString();
+    if (data.contains("quantity")) rule->quantity = data["quantity"].toInt();
+    if (data.contains("price")) rule->price = data["price"].toDouble();
+    if (data.contains("status")) rule->status = data["status"].toString();
+    if (data.contains("customerName") || data.contains("productName") || data.contains("status")) {
+        internStrings(*rule);
+        releaseStrings();
+    }
+    const qint64 updatedBefore = TimeIndex::key(rule->updatedAt);
+    rule->updatedAt = QDateTime::currentDateTime();
+    m_updatedIndex.move(updatedBefore, TimeIndex::key(rule->updatedAt), rule->id);
+    if (indexCondition(*rule)) {
+        scheduleRuleSetBuild();
+    }
     
+    recordChange(RuleChange::Updated, *rule);
     emit ruleUpdated(id);
-    emit rulesChanged();
+    notifyRulesChanged();
     
     return true;
 }
 
 bool RulesService::deleteRule(const QString& id)
 {
-    auto it = std::find_if(m_rules.begin(), m_rules.end(),
-        [&id](const Rule& o) { return o.id == id; });
-    
-    if (it == m_rules.end()) {
+    const qsizetype row = m_rowById.value(id, -1);
+    if (row < 0) {
         return false;
     }
     
-    m_rules.erase(it);
+    const Rule removed = m_rules.takeAt(row);
+    m_rowById.remove(removed.id);
+    for (qsizetype i = row; i < m_rules.size(); ++i) {
+        m_rowById[m_rules.at(i).id] = i;
+    }
+    unindexTimes(removed);
+    releaseStrings();
+    const bool wasStaged = m_staged.remove(id);
+    if (wasStaged && m_staged.isEmpty()) {
+        discardCandidate();
+    }
+    if (m_conditional.remove(id)) {
+        scheduleRuleSetBuild();     // rebuilds a remaining candidate too
+    } else if (wasStaged && !m_staged.isEmpty()) {
+        scheduleCandidateBuild();
+    }
     
+    recordChange(RuleChange::Deleted, removed);
     emit ruleDeleted(id);
-    emit rulesChanged();
+    notifyRulesChanged();
     
     return true;
 }
 
+qsizetype RulesService::insertRules(QList<Rule> rules)
+{
+    RULES_TRACE_SCOPE("RulesService::insertRules");
+    const QDateTime now = QDateTime::currentDateTime();
+    const qsizetype first = m_rules.size();
+    bool conditionsChanged = false;
+
+    m_rules.reserve(first + rules.size());
+    m_rowById.reserve(first + rules.size());
+    for (Rule& rule : rules) {
+        while (rule.id.isEmpty() || m_rowById.contains(rule.id)) {
+            rule.id = generateId();
+        }
+        if (!rule.createdAt.isValid()) rule.createdAt = now;
+        if (!rule.updatedAt.isValid()) rule.updatedAt = rule.createdAt;
+        if (rule.status.isEmpty()) rule.status = "pending";
+        if (!compileCondition(rule)) {
+            continue;
+        }
+
+        internStrings(rule);
+        m_rowById.insert(rule.id, m_rules.size());
+        m_rules.append(std::move(rule));
+        const Rule& stored = m_rules.constLast();
+        indexTimes(stored);
+        conditionsChanged = indexCondition(stored) || conditionsChanged;
+    }
+
+    const qsizetype inserted = m_rules.size() - first;
+    if (inserted == 0) {
+        return 0;
+    }
+    if (conditionsChanged) {
+        scheduleRuleSetBuild();
+    }
+
+    // Consumers would fall off a log this batch overflows anyway
+    if (static_cast<size_t>(inserted) <= m_changeLogCapacity) {
+        for (qsizetype i = first; i < m_rules.size(); ++i) {
+            recordChange(RuleChange::Created, m_rules.at(i));
+        }
+    } else {
+        recordMutation();
+        m_changeLog.clear();
+        m_changeFloor = m_generation;
+    }
+    notifyRulesChanged();
+    return inserted;
+}
+
+int RulesService::importRules(const QString& path)
+{
+    RULES_TRACE_SCOPE("RulesService::importRules");
+    BulkParseResult parsed = RuleBulkIo::parseFile(path, RuleBulkIo::formatForPath(path));
+    if (!parsed.error.isEmpty()) {
+        RULES_LOG_WARNING("RulesService", "Import of %1 failed: %2", path, parsed.error);
+        return -1;
+    }
+    if (parsed.rejected > 0) {
+        RULES_LOG_WARNING("RulesService", "Import of %1 skipped %2 malformed records; first: %3",
+                          path, QString::number(parsed.rejected), parsed.firstRejection);
+    }
+
+    const qsizetype parsedCount = parsed.rules.size();
+    const qsizetype inserted = insertRules(std::move(parsed.rules));
+    RULES_LOG_INFO("RulesService", "Imported %1 of %2 rules from %3",
+                   QString::number(inserted), QString::number(parsedCount + parsed.rejected), path);
+    return static_cast<int>(inserted);
+}
+
+bool RulesService::exportRules(const QString& path) const
+{
+    RULES_TRACE_SCOPE("RulesService::exportRules");
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)
+        || !RuleBulkIo::write(&file, m_rules, RuleBulkIo::formatForPath(path))
+        || !file.commit()) {
+        RULES_LOG_WARNING("RulesService", "Export to %1 failed: %2", path, file.errorString());
+        return false;
+    }
+    return true;
+}
+
 bool RulesService::updateStatus(const QString& id, const QString& status)
 {
     return updateRule(id, {{"status", status}});
@@ -153,6 +303,503 @@ double RulesService::getTotalRevenue() const
     return total;
 }
 
+// Workers look at QPromise::isCanceled() once per this many rules
+static constexpr qsizetype CANCEL_CHECK_INTERVAL = 4096;
+
+QFuture<QVariantList> RulesService::getAllRulesAsync() const
+{
+    return getRulesByStatusAsync(QString());
+}
+
+QFuture<QVariantList> RulesService::getRulesByStatusAsync(const QString& status) const
+{
+    return readAsync<QVariantList>([status](QPromise<QVariantList>& promise, const QList<Rule>& rules) {
+        RULES_TRACE_SCOPE("RulesService::getRulesByStatusAsync");
+        QVariantList result;
+        for (qsizetype i = 0; i < rules.size(); ++i) {
+            if (i % CANCEL_CHECK_INTERVAL == 0 && promise.isCanceled()) {
+                return;
+            }
+            if (status.isEmpty() || rules.at(i).status == status) {
+                result.append(rules.at(i).toVariantMap());
+            }
+        }
+        promise.addResult(std::move(result));
+    });
+}
+
+QFuture<double> RulesService::getTotalRevenueAsync() const
+{
+    return readAsync<double>([](QPromise<double>& promise, const QList<Rule>& rules) {
+        double total = 0;
+        for (qsizetype i = 0; i < rules.size(); ++i) {
+            if (i % CANCEL_CHECK_INTERVAL == 0 && promise.isCanceled()) {
+                return;
+            }
+            total += rules.at(i).quantity * rules.at(i).price;
+        }
+        promise.addResult(total);
+    });
+}
+
+void RulesService::fetchTotalRevenue(const QJSValue& callback)
+{
+    getTotalRevenueAsync().then(this, [callback](double total) mutable {
+        if (callback.isCallable()) {
+            callback.call({QJSValue(total)});
+        }
+    });
+}
+
+QList<Rule> RulesService::rulesInTimeRange(TimeField field, qint64 fromMs, qint64 toMs,
+                                          qsizetype limit) const
+{
+    QList<Rule> result;
+    if (limit == 0) {
+        return result;
+    }
+    timeIndex(field).scan(fromMs, toMs, [&](const QString& id) {
+        result.append(*findRule(id));
+        return limit < 0 || result.size() < limit;
+    });
+    return result;
+}
+
+QList<Rule> RulesService::recentRules(TimeField field, qsizetype count, const QString& status) const
+{
+    QList<Rule> result;
+    if (count == 0) {
+        return result;
+    }
+    timeIndex(field).scanNewest([&](const QString& id) {
+        const Rule* rule = findRule(id);
+        if (status.isEmpty() || rule->status == status) {
+            result.append(*rule);
+        }
+        return count < 0 || result.size() < count;
+    });
+    return result;
+}
+
+QVariantList RulesService::getRulesModifiedBetween(const QDateTime& from, const QDateTime& to) const
+{
+    QVariantList result;
+    for (const Rule& rule : rulesInTimeRange(TimeField::UpdatedAt, TimeIndex::key(from), TimeIndex::key(to))) {
+        result.append(rule.toVariantMap());
+    }
+    return result;
+}
+
+QVariantList RulesService::getRecentRules(int count) const
+{
+    QVariantList result;
+    for (const Rule& rule : recentRules(TimeField::UpdatedAt, qMax(0, count))) {
+        result.append(rule.toVariantMap());
+    }
+    return result;
+}
+
+QString RulesService::checkCondition(const QString& condition) const
+{
+    // Scratch table: validation must not grow the real slot table
+    expr::FieldTable fields = m_fields;
+    return expr::compile(condition, fields).error;
+}
+
+// Snapshot format: magic, version, count, then one fixed-order record per
+// rule with timestamps as epoch milliseconds (-1 for invalid). Version 2
+// appends the condition source. Only the records travel: programs hold
+// slots of this instance's FieldTable, and the id hash, time indexes and
+// string pool point into the adopted rules, so all of them are rebuilt on
+// adoption (each distinct condition compiled once). rules-bench
+// handoffReload measures the whole reload.
+static constexpr quint32 SNAPSHOT_MAGIC = 0x524C484F;  // "RLHO"
+static constexpr quint16 SNAPSHOT_VERSION = 2;
+
+// Smallest record on the wire: four empty strings (length prefix only),
+// quantity, price and both timestamps. Bounds the count a blob may claim.
+static constexpr qint64 SNAPSHOT_MIN_RECORD_BYTES = 4 * 4 + 4 + 8 + 8 + 8;
+
+bool RulesService::writeSnapshot(QIODevice* device) const
+{
+    QDataStream out(device);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    out << SNAPSHOT_MAGIC << SNAPSHOT_VERSION << static_cast<qint64>(m_rules.size());
+    for (const Rule& rule : m_rules) {
+        out << rule.id << rule.customerName << rule.productName
+            << static_cast<qint32>(rule.quantity) << rule.price << rule.status
+            << static_cast<qint64>(rule.createdAt.isValid() ? rule.createdAt.toMSecsSinceEpoch() : -1)
+            << static_cast<qint64>(rule.updatedAt.isValid() ? rule.updatedAt.toMSecsSinceEpoch() : -1)
+            << rule.condition;
+    }
+
+    return out.status() == QDataStream::Ok;
+}
+
+bool RulesService::readSnapshot(QIODevice* device)
+{
+    QDataStream in(device);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    qint64 count = 0;
+    in >> magic >> version >> count;
+    if (magic != SNAPSHOT_MAGIC || version < 1 || version > SNAPSHOT_VERSION || count < 0) {
+        return false;
+    }
+    // The count is untrusted: never reserve more than the payload could hold
+    const qint64 available = device->bytesAvailable();
+    if (in.status() != QDataStream::Ok || (available >= 0 && count > available / SNAPSHOT_MIN_RECORD_BYTES)) {
+        return false;
+    }
+
+    QList<Rule> rules;
+    rules.reserve(count);
+    QHash<QString, std::shared_ptr<const expr::Program>> programs;  // by source, null if rejected
+    for (qint64 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        Rule rule;
+        qint32 quantity = 0;
+        qint64 createdMs = -1;
+        qint64 updatedMs = -1;
+        in >> rule.id >> rule.customerName >> rule.productName
+           >> quantity >> rule.price >> rule.status >> createdMs >> updatedMs;
+        if (version >= 2) {
+            in >> rule.condition;
+        }
+        rule.quantity = quantity;
+        if (!rule.condition.isEmpty()) {
+            // Catalogs repeat a handful of conditions
+            auto known = programs.constFind(rule.condition);
+            if (known != programs.constEnd()) {
+                rule.program = known.value();
+            } else {
+                const QString source = rule.condition;
+                compileCondition(rule);
+                programs.insert(source, rule.program);
+            }
+            if (!rule.program) {
+                rule.condition.clear();  // the language changed under an old blob
+            }
+        }
+        if (createdMs >= 0) rule.createdAt = QDateTime::fromMSecsSinceEpoch(createdMs);
+        if (updatedMs >= 0) rule.updatedAt = QDateTime::fromMSecsSinceEpoch(updatedMs);
+        rules.append(std::move(rule));
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    m_rules = std::move(rules);
+    discardCandidate();
+    m_conditional.clear();
+    m_rowById.clear();
+    m_createdIndex.clear();
+    m_updatedIndex.clear();
+    m_rowById.reserve(m_rules.size());
+    for (qsizetype i = 0; i < m_rules.size(); ++i) {
+        Rule& rule = m_rules[i];
+        // Same policy as insertRules(): every row gets a unique id, so the
+        // id hash and the time indexes always agree with m_rules
+        while (rule.id.isEmpty() || m_rowById.contains(rule.id)) {
+            rule.id = generateId();
+        }
+        internStrings(rule);
+        m_rowById.insert(rule.id, i);
+        indexTimes(rule);
+        indexCondition(rule);
+    }
+    m_strings.purge();     // values only the replaced rules used
+    m_releasedStrings = 0;
+    scheduleRuleSetBuild();
+    recordMutation();
+
+    // Individual changes do not describe a wholesale replacement
+    m_changeLog.clear();
+    m_changeFloor = m_generation;
+    notifyRulesChanged();
+    return true;
+}
+
+void RulesService::recordMutation()
+{
+    ++m_generation;
+    MetricCounters& c = RulesMetrics::counters();
+    metrics::count(c.mutations);
+    metrics::gauge(c.ruleCount, m_rules.size());
+}
+
+// One rulesChanged per public mutation, however many rows it touched
+void RulesService::notifyRulesChanged()
+{
+    metrics::count(RulesMetrics::counters().rulesChangedEmitted);
+    emit rulesChanged();
+}
+
+void RulesService::recordChange(RuleChange::Kind kind, const Rule& rule)
+{
+    recordMutation();
+    if (m_changeLogCapacity == 0) {
+        m_changeFloor = m_generation;
+        return;
+    }
+
+    m_changeLog.push_back({m_generation, kind, rule});
+    if (m_changeLog.size() > m_changeLogCapacity) {
+        m_changeFloor = m_changeLog.front().sequence;
+        m_changeLog.pop_front();
+    }
+}
+
+ChangeSet RulesService::changesSince(quint64 sequence) const
+{
+    ChangeSet set;
+    set.sequence = m_generation;
+
+    // Behind the log, or a sequence from another service instance
+    if (sequence < m_changeFloor || sequence > m_generation) {
+        set.reset = true;
+        set.rules = m_rules;
+        metrics::count(RulesMetrics::counters().changeFeedResets);
+        return set;
+    }
+
+    auto first = std::upper_bound(m_changeLog.begin(), m_changeLog.end(), sequence,
+        [](quint64 seq, const RuleChange& change) { return seq < change.sequence; });
+    set.changes.reserve(std::distance(first, m_changeLog.end()));
+    std::copy(first, m_changeLog.end(), std::back_inserter(set.changes));
+    return set;
+}
+
+QVariantMap RulesService::getChangesSince(qint64 sequence) const
+{
+    static const char* const kinds[] = {"created", "updated", "deleted"};
+
+    const ChangeSet set = changesSince(static_cast<quint64>(qMax<qint64>(0, sequence)));
+    QVariantList changes;
+    changes.reserve(set.changes.size());
+    for (const RuleChange& change : set.changes) {
+        changes.append(QVariantMap{
+            {"sequence", static_cast<qint64>(change.sequence)},
+            {"kind", kinds[change.kind]},
+            {"id", change.rule.id},
+            {"rule", change.rule.toVariantMap()}
+        });
+    }
+
+    QVariantMap result{
+        {"sequence", static_cast<qint64>(set.sequence)},
+        {"reset", set.reset},
+        {"changes", changes}
+    };
+    if (set.reset) {
+        QVariantList rules;
+        rules.reserve(set.rules.size());
+        for (const Rule& rule : set.rules) {
+            rules.append(rule.toVariantMap());
+        }
+        result.insert("rules", rules);
+    }
+    return result;
+}
+
+void RulesService::setChangeLogCapacity(int capacity)
+{
+    m_changeLogCapacity = static_cast<size_t>(qMax(0, capacity));
+    while (m_changeLog.size() > m_changeLogCapacity) {
+        m_changeFloor = m_changeLog.front().sequence;
+        m_changeLog.pop_front();
+    }
+    if (m_changeLog.empty()) {
+        m_changeFloor = m_generation;
+    }
+}
+
+bool RulesService::compileCondition(Rule& rule)
+{
+    if (rule.condition.trimmed().isEmpty()) {
+        rule.condition.clear();
+        rule.program.reset();
+        return true;
+    }
+
+    expr::CompileResult result = expr::compile(rule.condition, m_fields);
+    if (!result.program) {
+        RULES_LOG_WARNING("RulesService", "Rejected condition \"%1\": %2", rule.condition, result.error);
+        return false;
+    }
+
+    rule.program = std::move(result.program);
+    return true;
+}
+
+bool RulesService::indexCondition(const Rule& rule)
+{
+    if (rule.program && rule.status == QLatin1String("active")) {
+        m_conditional.insert(rule.id, {rule.id, rule.customerName, rule.program});
+        return true;
+    }
+    return m_conditional.remove(rule.id);
+}
+
+void RulesService::scheduleRuleSetBuild()
+{
+    std::lock_guard<std::mutex> lock(m_buildMutex);
+    m_pendingBuild = RuleSetSource{++m_conditionsVersion, m_conditional, m_fields};
+    if (!m_staged.isEmpty()) {
+        // The candidate overlays the active rules, so it follows their changes
+        m_pendingCandidateBuild = RuleSetSource{++m_candidateVersion, candidateConditions(), m_fields};
+    }
+    startBuilderLocked();
+}
+
+void RulesService::scheduleCandidateBuild()
+{
+    std::lock_guard<std::mutex> lock(m_buildMutex);
+    m_candidateStaged = true;
+    m_pendingCandidateBuild = RuleSetSource{++m_candidateVersion, candidateConditions(), m_fields};
+    startBuilderLocked();
+}
+
+void RulesService::startBuilderLocked()
+{
+    if (m_buildRunning) {
+        return;  // the running builder picks up the latest sources when done
+    }
+    m_buildRunning = true;
+    m_buildFuture = QtConcurrent::run([this]() { runRuleSetBuilds(); });
+}
+
+void RulesService::runRuleSetBuilds()
+{
+    for (;;) {
+        RuleSetSource source;
+        RuleSetSlot* target = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_buildMutex);
+            std::optional<RuleSetSource>& pending = m_pendingBuild ? m_pendingBuild : m_pendingCandidateBuild;
+            if (!pending) {
+                m_buildRunning = false;
+                return;
+            }
+            target = &pending == &m_pendingBuild ? m_ruleSets.get() : m_candidateSets.get();
+            source = std::move(*pending);
+            pending.reset();
+        }
+
+        RULES_TRACE_SCOPE("RulesService::buildRuleSet");
+        target->publish(CompiledRuleSet::build(source.version, source.rules, source.fields));
+
+        if (target == m_candidateSets.get()) {
+            // Shadowing starts only once the latest staged state is
+            // visible, never against a stale or discarded candidate
+            std::lock_guard<std::mutex> lock(m_buildMutex);
+            if (source.version == m_candidateVersion && m_candidateStaged) {
+                m_hasCandidate.store(true, std::memory_order_release);
+            }
+        }
+    }
+}
+
+QHash<QString, CompiledRule> RulesService::candidateConditions() const
+{
+    QHash<QString, CompiledRule> candidate = m_conditional;
+    for (auto it = m_staged.cbegin(); it != m_staged.cend(); ++it) {
+        const Rule* rule = findRule(it.key());
+        if (rule && it->program && rule->status == QLatin1String("active")) {
+            candidate.insert(it.key(), {it.key(), rule->customerName, it->program});
+        } else {
+            candidate.remove(it.key());
+        }
+    }
+    return candidate;
+}
+
+bool RulesService::stageCondition(const QString& id, const QString& condition)
+{
+    if (!findRule(id)) {
+        return false;
+    }
+
+    Rule candidate;
+    candidate.condition = condition;
+    if (!compileCondition(candidate)) {
+        return false;
+    }
+
+    m_staged.insert(id, {candidate.condition, candidate.program});
+    scheduleCandidateBuild();
+    return true;
+}
+
+void RulesService::discardCandidate()
+{
+    m_staged.clear();
+
+    std::lock_guard<std::mutex> lock(m_buildMutex);
+    m_pendingCandidateBuild.reset();
+    m_candidateStaged = false;
+    m_hasCandidate.store(false, std::memory_order_release);
+}
+
+bool RulesService::promoteCandidate()
+{
+    if (m_staged.isEmpty()) {
+        return false;
+    }
+
+    // Staged conditions already compiled; updateRule recompiles from source
+    const QHash<QString, StagedCondition> staged = m_staged;
+    discardCandidate();
+    bool allApplied = true;
+    for (auto it = staged.cbegin(); it != staged.cend(); ++it) {
+        allApplied = updateRule(it.key(), {{"condition", it->condition}}) && allApplied;
+    }
+    return allApplied;
+}
+
+const Rule* RulesService::findRule(const QString& id) const
+{
+    const qsizetype row = m_rowById.value(id, -1);
+    return row >= 0 ? &m_rules.at(row) : nullptr;
+}
+
+Rule* RulesService::findRule(const QString& id)
+{
+    const qsizetype row = m_rowById.value(id, -1);
+    return row >= 0 ? &m_rules[row] : nullptr;
+}
+
+void RulesService::indexTimes(const Rule& rule)
+{
+    m_createdIndex.insert(TimeIndex::key(rule.createdAt), rule.id);
+    m_updatedIndex.insert(TimeIndex::key(rule.updatedAt), rule.id);
+}
+
+void RulesService::unindexTimes(const Rule& rule)
+{
+    m_createdIndex.remove(TimeIndex::key(rule.createdAt), rule.id);
+    m_updatedIndex.remove(TimeIndex::key(rule.updatedAt), rule.id);
+}
+
+void RulesService::internStrings(Rule& rule)
+{
+    m_strings.intern(rule.customerName);
+    m_strings.intern(rule.productName);
+    m_strings.intern(rule.status);
+}
+
+void RulesService::releaseStrings()
+{
+    // Purging visits the whole pool, so do it once per pool-size releases
+    if (++m_releasedStrings > m_strings.size()) {
+        m_strings.purge();
+        m_releasedStrings = 0;
+    }
+}
+
 QString RulesService::generateId() const
 {
     return QUuid::createUuid().toString(QUuid::WithoutBraces).left(8);
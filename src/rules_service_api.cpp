@@ -0,0 +1,190 @@
+#include "rules_service_api.h"
+#include "rule_set.h"
+#include "epoch.h"
+#include "trace.h"
+
+#include <QThread>
+#include <algorithm>
+
+namespace rules {
+
+namespace {
+
+// Slot of a record field if some active condition reads it, else -1
+int readSlot(const CompiledRuleSet& set, const QString& path)
+{
+    const int slot = set.fields.find(path);
+    return slot >= 0 && std::binary_search(set.fieldSlots.begin(), set.fieldSlots.end(), slot)
+        ? slot : -1;
+}
+
+} // namespace
+
+RulesServiceApi::RulesServiceApi(QObject* context, Activator activate)
+    : m_context(context)
+    , m_activate(std::move(activate))
+{
+}
+
+void RulesServiceApi::shutdown()
+{
+    // Sequentially consistent with Call: either a call sees m_stopped, or
+    // its m_inFlight increment is seen here and waited for
+    m_stopped.store(true);
+    m_service.store(nullptr, std::memory_order_release);
+    while (m_inFlight.load() != 0) {
+        QThread::yieldCurrentThread();   // calls are short; evaluate() is one batch
+    }
+}
+
+RulesServiceApi::Call::Call(const RulesServiceApi& api)
+    : m_api(api)
+{
+    // Activation may block on the context thread, so it runs before the
+    // call counts as in flight (shutdown() runs on that thread too)
+    RulesService* service = api.service();
+    api.m_inFlight.fetch_add(1);
+    if (service && !api.m_stopped.load()) {
+        m_service = service;
+    }
+}
+
+RulesServiceApi::Call::~Call()
+{
+    m_api.m_inFlight.fetch_sub(1, std::memory_order_release);
+}
+
+// nullptr once shut down
+RulesService* RulesServiceApi::service() const
+{
+    if (m_stopped.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    RulesService* service = m_service.load(std::memory_order_acquire);
+    if (service) {
+        return service;
+    }
+
+    // Re-checked on the context thread: stop() may have run while queued
+    auto activate = [this]() {
+        return m_stopped.load(std::memory_order_acquire) ? nullptr : m_activate();
+    };
+    if (QThread::currentThread() == m_context->thread()) {
+        service = activate();
+    } else {
+        QMetaObject::invokeMethod(m_context, [&service, &activate]() { service = activate(); },
+                                  Qt::BlockingQueuedConnection);
+    }
+    if (service && !m_stopped.load(std::memory_order_acquire)) {
+        m_service.store(service, std::memory_order_release);
+    }
+    return service;
+}
+
+quint64 RulesServiceApi::evaluate(const OrderRecord* orders, qsizetype count,
+                                  EvaluationResult* results, std::vector<QString>& matches) const
+{
+    RULES_TRACE_SCOPE("RulesServiceApi::evaluate");
+
+    const Call call(*this);
+    const RulesService* rules = call.service();
+    if (!rules) {
+        std::fill(results, results + count, EvaluationResult{static_cast<quint32>(matches.size()), 0});
+        return 0;
+    }
+
+    epoch::Guard guard;
+    const CompiledRuleSet* set = rules->compiledRules().acquire();
+
+    static const QString orderIdPath = QStringLiteral("orderId");
+    static const QString customerNamePath = QStringLiteral("customerName");
+    static const QString statusPath = QStringLiteral("status");
+    static const QString totalAmountPath = QStringLiteral("totalAmount");
+    static const QString quantityPath = QStringLiteral("quantity");
+    static const QString pricePath = QStringLiteral("price");
+
+    // Resolved once per call; only fields some condition reads are bound
+    const int orderIdSlot = readSlot(*set, orderIdPath);
+    const int customerNameSlot = readSlot(*set, customerNamePath);
+    const int statusSlot = readSlot(*set, statusPath);
+    const int totalAmountSlot = readSlot(*set, totalAmountPath);
+    const int quantitySlot = readSlot(*set, quantityPath);
+    const int priceSlot = readSlot(*set, pricePath);
+
+    // Reused by every call on this thread, so it only grows with the field
+    // table. Strings are bound as raw views of the caller's data (no copy)
+    // and every bound slot is reset before returning.
+    thread_local std::vector<expr::Value> fields;
+    if (fields.size() < static_cast<size_t>(set->fields.size())) {
+        fields.resize(static_cast<size_t>(set->fields.size()));
+    }
+    auto bindString = [](int slot, QStringView text) {
+        if (slot >= 0) {
+            fields[static_cast<size_t>(slot)] =
+                expr::Value::fromString(QString::fromRawData(text.data(), text.size()));
+        }
+    };
+    auto bindNumber = [](int slot, double value) {
+        if (slot >= 0) {
+            fields[static_cast<size_t>(slot)] = expr::Value::fromNumber(value);
+        }
+    };
+
+    for (qsizetype i = 0; i < count; ++i) {
+        const OrderRecord& order = orders[i];
+        bindString(orderIdSlot, order.orderId);
+        bindString(customerNameSlot, order.customerName);
+        bindString(statusSlot, order.status);
+        bindNumber(totalAmountSlot, order.totalAmount);
+        bindNumber(quantitySlot, order.quantity);
+        bindNumber(priceSlot, order.price);
+
+        EvaluationResult& result = results[i];
+        result.first = static_cast<quint32>(matches.size());
+        for (const CompiledRule& rule : set->rules) {
+            if (rule.program->matches(fields.data())) {
+                matches.push_back(rule.id);
+            }
+        }
+        result.count = static_cast<quint32>(matches.size()) - result.first;
+    }
+
+    for (int slot : {orderIdSlot, customerNameSlot, statusSlot, totalAmountSlot, quantitySlot, priceSlot}) {
+        if (slot >= 0) {
+            fields[static_cast<size_t>(slot)] = expr::Value();   // drop views of the caller's strings
+        }
+    }
+    return set->version;
+}
+
+RuleHandle RulesServiceApi::find(const QString& id) const
+{
+    const Call call(*this);
+    const RulesService* rules = call.service();
+    if (!rules) {
+        return {};
+    }
+    const qsizetype row = rules->rowOf(id);
+    return row >= 0 ? RuleHandle{static_cast<quint32>(row), rules->generation()} : RuleHandle{};
+}
+
+const Rule* RulesServiceApi::rule(RuleHandle handle) const
+{
+    const Call call(*this);
+    const RulesService* rules = call.service();
+    if (!rules) {
+        return nullptr;
+    }
+    const QList<Rule>& store = rules->rules();
+    return handle.generation == rules->generation() && handle.index < quint32(store.size())
+        ? &store.at(handle.index) : nullptr;
+}
+
+RulesSnapshot RulesServiceApi::snapshot() const
+{
+    const Call call(*this);
+    const RulesService* rules = call.service();
+    return rules ? RulesSnapshot(rules->generation(), rules->rules()) : RulesSnapshot();
+}
+
+} // namespace rules
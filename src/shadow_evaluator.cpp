@@ -0,0 +1,103 @@
+#include "shadow_evaluator.h"
+#include "rule_set.h"
+#include "epoch.h"
+#include "plugin_log.h"
+#include "rules_metrics.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+
+namespace rules {
+
+ShadowEvaluator::ShadowEvaluator(const RuleSetSlot& candidates, size_t capacity)
+    : m_candidates(candidates)
+    , m_capacity(capacity)
+{
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName(QStringLiteral("rules-shadow"));
+    m_thread->start(QThread::LowestPriority);
+}
+
+ShadowEvaluator::~ShadowEvaluator()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_thread->wait();
+    delete m_thread;
+}
+
+bool ShadowEvaluator::submit(ShadowJob&& job)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+        if (!lock.owns_lock() || m_queue.size() >= m_capacity) {
+            metrics::count(RulesMetrics::counters().shadowShed);
+            return false;
+        }
+        m_queue.push_back(std::move(job));
+    }
+    m_wake.notify_one();
+    return true;
+}
+
+void ShadowEvaluator::run()
+{
+    for (;;) {
+        ShadowJob job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+            if (m_stopping) {
+                return;
+            }
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        evaluate(job);
+    }
+}
+
+void ShadowEvaluator::evaluate(const ShadowJob& job)
+{
+    epoch::Guard guard;
+    const CompiledRuleSet* candidate = m_candidates.acquire();
+
+    MetricCounters& counters = RulesMetrics::counters();
+    if (candidate->version != job.candidateVersion) {
+        // Restaged since the event was bound: its fields may not cover
+        // this set's slots, and the comparison would be against rules the
+        // event never saw
+        metrics::count(counters.shadowShed);
+        return;
+    }
+
+    QStringList candidateMatched;
+    QElapsedTimer timer;
+    timer.start();
+    for (const CompiledRule& rule : candidate->rules) {
+        if (rule.program->matches(job.fields.data())) {
+            candidateMatched.append(rule.id);
+        }
+    }
+    const qint64 candidateNs = timer.nsecsElapsed();
+
+    metrics::count(counters.shadowEvaluated);
+    if (job.activeNs >= 0) {
+        // Cost pairs only: a memo hit says nothing about the active cost
+        metrics::count(counters.shadowActiveNs, static_cast<quint64>(job.activeNs));
+        metrics::count(counters.shadowCandidateNs, static_cast<quint64>(candidateNs));
+    }
+
+    if (candidateMatched != job.activeMatched) {
+        metrics::count(counters.shadowDivergent);
+        RULES_LOG_RATE_LIMITED(log::Level::Info, 10, "RuleEngine",
+                               "Shadow divergence on order %1: active [%2], candidate [%3]",
+                               job.orderId, job.activeMatched.join(QLatin1Char(',')),
+                               candidateMatched.join(QLatin1Char(',')));
+    }
+}
+
+} // namespace rules
@@ -0,0 +1,266 @@
+#include "sharded_checker.h"
+#include "result_cache.h"
+#include "rules_service.h"
+#include "rule_set.h"
+#include "shadow_evaluator.h"
+#include "work_stealing_pool.h"
+#include "epoch.h"
+#include "rules_metrics.h"
+#include "trace.h"
+
+#include <QElapsedTimer>
+#include <utility>
+
+namespace rules {
+
+namespace {
+
+// How a FieldTable slot gets its value for one event
+struct FieldBinding {
+    QStringList path;       // payload path
+    int window = -1;        // >= 0: window.<name>.<stat> of the customer
+    int stat = 0;           // 0 count, 1 sum, 2 min, 3 max
+};
+
+} // namespace
+
+struct ShardedChecker::Shard {
+    std::mutex mutex;
+    std::vector<CheckRequest> inbox;
+    bool scheduled = false;     // a pool task is draining this shard
+
+    // Only touched by the draining task. batch and inbox swap on every
+    // drain, so both keep their capacity instead of reallocating.
+    std::vector<CheckRequest> batch;
+    std::vector<int> matched;   // matched rule indices of the current event
+    std::vector<FieldBinding> bindings;
+    std::vector<expr::Value> fieldValues;
+    std::unique_ptr<ResultCache> memo;
+    qint64 averageEvalNs = 0;   // of evaluated (missed) events, for saved-time accounting
+};
+
+ShardedChecker::ShardedChecker(const RulesService& rules, WorkStealingPool& pool,
+                               std::vector<WindowSpec> windows, int shardCount,
+                               ResultHandler onResult, ShadowEvaluator* shadow,
+                               size_t memoEntries)
+    : m_rules(rules)
+    , m_pool(pool)
+    , m_windows(std::move(windows))
+    , m_onResult(std::move(onResult))
+    , m_shadow(shadow)
+{
+    m_shards.reserve(static_cast<size_t>(qMax(1, shardCount)));
+    for (int i = 0; i < qMax(1, shardCount); ++i) {
+        auto shard = std::make_unique<Shard>();
+        if (memoEntries > 0) {
+            // Same customer, same shard: retries and replays hit locally
+            shard->memo = std::make_unique<ResultCache>(
+                qMax<size_t>(16, memoEntries / static_cast<size_t>(qMax(1, shardCount))));
+        }
+        m_shards.push_back(std::move(shard));
+    }
+}
+
+ShardedChecker::~ShardedChecker()
+{
+    // Pool tasks reference the shards
+    waitForIdle();
+}
+
+void ShardedChecker::submit(CheckRequest&& request)
+{
+    const QString& key = request.customer.isEmpty() ? request.orderId : request.customer;
+    Shard& shard = *m_shards[qHash(key) % m_shards.size()];
+
+    m_pending.fetch_add(1);
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.inbox.push_back(std::move(request));
+        schedule = !std::exchange(shard.scheduled, true);
+    }
+    if (schedule) {
+        m_pool.submit([this, &shard]() { drain(shard); });
+    }
+}
+
+void ShardedChecker::waitForIdle()
+{
+    std::unique_lock<std::mutex> lock(m_idleMutex);
+    m_idle.wait(lock, [this]() { return m_pending.load() == 0; });
+}
+
+void ShardedChecker::drain(Shard& shard)
+{
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.batch.swap(shard.inbox);
+        }
+
+        for (const CheckRequest& request : shard.batch) {
+            check(shard, request);
+        }
+        const auto checked = static_cast<qint64>(shard.batch.size());
+        shard.batch.clear();
+
+        bool more = false;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            more = !shard.inbox.empty();
+            shard.scheduled = more;
+        }
+
+        // Under the idle mutex: once a waiter sees zero, this task no
+        // longer touches the checker
+        std::lock_guard<std::mutex> lock(m_idleMutex);
+        if (m_pending.fetch_sub(checked) == checked) {
+            m_idle.notify_all();
+        }
+        if (!more) {
+            return;
+        }
+    }
+}
+
+void ShardedChecker::check(Shard& shard, const CheckRequest& request)
+{
+    RULES_TRACE_SCOPE("ShardedChecker::check");
+
+    // One consistent rule set for the whole event, even if an edit swaps
+    // in a new version meanwhile
+    epoch::Guard guard;
+    const CompiledRuleSet* ruleSet = m_rules.compiledRules().acquire();
+    const CompiledRuleSet* candidate = m_shadow && m_rules.hasCandidate()
+        ? m_rules.candidateRules().acquire() : nullptr;
+    if (ruleSet->rules.empty() && !candidate) {
+        return;
+    }
+
+    // Every set's table is a snapshot of the same append-only table, so
+    // bindings resolved for one set stay valid for later ones
+    auto bindFields = [this, &shard, &request](const CompiledRuleSet& set) {
+        const expr::FieldTable& fields = set.fields;
+        while (static_cast<int>(shard.bindings.size()) < fields.size()) {
+            FieldBinding binding;
+            binding.path = fields.path(static_cast<int>(shard.bindings.size())).split(QLatin1Char('.'));
+            if (binding.path.size() == 3 && binding.path.first() == QLatin1String("window")) {
+                static const QStringList stats = {"count", "sum", "min", "max"};
+                for (size_t w = 0; w < m_windows.size(); ++w) {
+                    if (m_windows[w].name == binding.path.at(1)) {
+                        binding.window = static_cast<int>(w);
+                    }
+                }
+                binding.stat = static_cast<int>(stats.indexOf(binding.path.at(2)));
+                if (binding.stat < 0) {
+                    binding.window = -1;
+                }
+            }
+            shard.bindings.push_back(std::move(binding));
+        }
+        shard.fieldValues.resize(shard.bindings.size());
+
+        // Only the slots some rule of this set reads
+        for (int fieldSlot : set.fieldSlots) {
+            const auto slot = static_cast<size_t>(fieldSlot);
+            const FieldBinding& binding = shard.bindings[slot];
+
+            if (binding.window >= 0) {
+                const auto w = static_cast<size_t>(binding.window);
+                const WindowStats stats = w < request.windows.size() ? request.windows[w] : WindowStats{};
+                const double values[] = {double(stats.count), stats.sum, stats.min, stats.max};
+                shard.fieldValues[slot] = expr::Value::fromNumber(values[binding.stat]);
+                continue;
+            }
+
+            QVariant value = request.data.value(binding.path.first());
+            for (qsizetype i = 1; i < binding.path.size() && value.isValid(); ++i) {
+                value = value.toMap().value(binding.path.at(i));
+            }
+            shard.fieldValues[slot] = expr::Value::fromVariant(value);
+        }
+    };
+
+    bindFields(*ruleSet);
+    if (candidate) {
+        bindFields(*candidate);
+    }
+
+    CheckResult result;
+    result.orderId = request.orderId;
+    result.checkedAt = request.nowMs;
+
+    MetricCounters& counters = RulesMetrics::counters();
+    auto report = [&result, ruleSet](size_t rule) {
+        result.matchedRules.append(ruleSet->rules[rule].id);
+        result.reasons.append(ruleSet->rules[rule].name);
+    };
+
+    // The memo answers for the active set even while shadowing; only
+    // uncached evaluations are timed for the shadow cost comparison
+    ResultCache* memo = shard.memo.get();
+    size_t memoHash = 0;
+    bool cached = false;
+    if (memo) {
+        memoHash = ResultCache::hashFields(ruleSet->version, ruleSet->fieldSlots, shard.fieldValues.data());
+        if (const std::vector<int>* matched = memo->find(ruleSet->version, ruleSet->fieldSlots,
+                                                         shard.fieldValues.data(), memoHash)) {
+            for (int rule : *matched) {
+                report(static_cast<size_t>(rule));
+            }
+            metrics::count(counters.memoHits);
+            metrics::count(counters.memoSavedNs, static_cast<quint64>(shard.averageEvalNs));
+            cached = true;
+        } else {
+            metrics::count(counters.memoMisses);
+        }
+    }
+
+    qint64 activeNs = -1;
+    if (!cached) {
+        QElapsedTimer timer;
+        if (candidate || memo) {
+            timer.start();
+        }
+        shard.matched.clear();
+        for (size_t i = 0; i < ruleSet->rules.size(); ++i) {
+            if (ruleSet->rules[i].program->matches(shard.fieldValues.data())) {
+                shard.matched.push_back(static_cast<int>(i));
+                report(i);
+            }
+        }
+        if (timer.isValid()) {
+            activeNs = timer.nsecsElapsed();
+        }
+
+        if (memo) {
+            // Exponential average; the first sample seeds it
+            shard.averageEvalNs = shard.averageEvalNs == 0
+                ? activeNs : shard.averageEvalNs + (activeNs - shard.averageEvalNs) / 16;
+            memo->insert(ruleSet->version, ruleSet->fieldSlots, shard.fieldValues.data(), memoHash,
+                         shard.matched);
+        }
+        metrics::count(counters.conditionsEvaluated, static_cast<quint64>(ruleSet->rules.size()));
+    }
+
+    if (candidate) {
+        ShadowJob job;
+        job.activeNs = activeNs;
+        job.orderId = request.orderId;
+        job.candidateVersion = candidate->version;
+        job.fields = shard.fieldValues;
+        job.activeMatched = result.matchedRules;
+        m_shadow->submit(std::move(job));
+        if (ruleSet->rules.empty()) {
+            return;     // nothing active to report yet
+        }
+    }
+
+    metrics::count(counters.conditionsMatched, static_cast<quint64>(result.matchedRules.size()));
+
+    if (m_onResult) {
+        m_onResult(result);
+    }
+}
+
+} // namespace rules
@@ -0,0 +1,83 @@
+#include "timing_wheel.h"
+
+#include <algorithm>
+
+namespace rules {
+
+TimingWheel::TimingWheel(qint64 tickMs, qint64 startMs)
+    : m_tickMs(std::max<qint64>(tickMs, 1))
+    , m_currentTick(startMs / m_tickMs)
+{
+}
+
+void TimingWheel::schedule(TimerId id, qint64 deadlineMs)
+{
+    insert({id, std::max(deadlineMs / m_tickMs, m_currentTick)});
+    ++m_pending;
+}
+
+std::vector<TimingWheel::TimerId> TimingWheel::advance(qint64 nowMs)
+{
+    std::vector<TimerId> expired;
+    const qint64 target = nowMs / m_tickMs;
+
+    while (m_currentTick <= target) {
+        const int index = static_cast<int>(m_currentTick & MASK);
+
+        // Level 0 wrapped: pull the next span down from the upper levels
+        if (index == 0) {
+            for (int level = 1; level < LEVELS; ++level) {
+                const int upper = static_cast<int>((m_currentTick >> (BITS * level)) & MASK);
+                cascade(level, upper);
+                if (upper != 0) {
+                    break;
+                }
+            }
+        }
+
+        std::vector<Entry> due;
+        due.swap(m_levels[0][static_cast<size_t>(index)]);
+        for (const Entry& entry : due) {
+            if (entry.tick <= m_currentTick) {
+                expired.push_back(entry.id);
+                --m_pending;
+            } else {
+                insert(entry);  // clamped beyond the wheel's span
+            }
+        }
+
+        if (m_currentTick == target) {
+            break;
+        }
+        ++m_currentTick;
+    }
+
+    return expired;
+}
+
+void TimingWheel::insert(const Entry& entry)
+{
+    const qint64 delta = entry.tick - m_currentTick;
+
+    for (int level = 0; level < LEVELS; ++level) {
+        if (delta < (qint64(1) << (BITS * (level + 1))) || level == LEVELS - 1) {
+            const qint64 tick = level == LEVELS - 1
+                ? std::min(entry.tick, m_currentTick + (qint64(1) << (BITS * LEVELS)) - 1)
+                : entry.tick;
+            const auto index = static_cast<size_t>((tick >> (BITS * level)) & MASK);
+            m_levels[static_cast<size_t>(level)][index].push_back(entry);
+            return;
+        }
+    }
+}
+
+void TimingWheel::cascade(int level, int index)
+{
+    std::vector<Entry> entries;
+    entries.swap(m_levels[static_cast<size_t>(level)][static_cast<size_t>(index)]);
+    for (const Entry& entry : entries) {
+        insert(entry);
+    }
+}
+
+} // namespace rules
@@ -0,0 +1,174 @@
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QThread>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace rules::trace {
+
+namespace {
+
+struct Event {
+    const char* name;
+    qint64 startNs;
+    qint64 durationNs;
+};
+
+struct ThreadBuffer {
+    std::mutex mutex;       // only contended while exporting
+    std::vector<Event> events;
+    QString threadName;
+    int tid = 0;
+    quint64 dropped = 0;
+};
+
+constexpr size_t MAX_EVENTS_PER_THREAD = 1 << 20;
+
+std::atomic<bool> g_enabled{qEnvironmentVariableIsSet("MPF_RULES_TRACE_FILE")};
+
+std::mutex g_registryMutex;
+std::vector<std::shared_ptr<ThreadBuffer>> g_buffers;
+
+qint64 nowNs()
+{
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch).count();
+}
+
+ThreadBuffer& localBuffer()
+{
+    // Registry keeps a reference, so spans survive the thread that recorded them
+    thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+        auto created = std::make_shared<ThreadBuffer>();
+        QThread* thread = QThread::currentThread();
+        created->threadName = thread->objectName();
+        if (created->threadName.isEmpty()) {
+            bool isMain = QCoreApplication::instance()
+                && QCoreApplication::instance()->thread() == thread;
+            created->threadName = isMain ? QStringLiteral("main") : QStringLiteral("worker");
+        }
+
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        created->tid = static_cast<int>(g_buffers.size()) + 1;
+        g_buffers.push_back(created);
+        return created;
+    }();
+    return *buffer;
+}
+
+QByteArray jsonString(const QString& value)
+{
+    QByteArray out = "\"";
+    for (QChar c : value) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c.toLatin1();
+        } else if (c.unicode() < 0x20) {
+            out += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0')).toLatin1();
+        } else {
+            out += QString(c).toUtf8();
+        }
+    }
+    out += '"';
+    return out;
+}
+
+} // namespace
+
+bool isEnabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void setEnabled(bool enabled)
+{
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void clear()
+{
+    std::lock_guard<std::mutex> registryLock(g_registryMutex);
+    for (const auto& buffer : g_buffers) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        buffer->events.clear();
+        buffer->dropped = 0;
+    }
+}
+
+bool exportChromeJson(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    bool first = true;
+    auto writeEvent = [&](const QByteArray& json) {
+        file.write(first ? "\n" : ",\n");
+        file.write(json);
+        first = false;
+    };
+
+    file.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    std::lock_guard<std::mutex> registryLock(g_registryMutex);
+    for (const auto& buffer : g_buffers) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+
+        writeEvent(QString("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%1,\"tid\":%2,\"args\":{\"name\":")
+                       .arg(pid).arg(buffer->tid).toUtf8()
+                   + jsonString(buffer->threadName) + "}}");
+
+        for (const Event& event : buffer->events) {
+            writeEvent(QString("{\"ph\":\"X\",\"cat\":\"rules\",\"name\":\"%1\",\"pid\":%2,\"tid\":%3,"
+                               "\"ts\":%4,\"dur\":%5}")
+                           .arg(QLatin1String(event.name))
+                           .arg(pid)
+                           .arg(buffer->tid)
+                           .arg(event.startNs / 1000.0, 0, 'f', 3)
+                           .arg(event.durationNs / 1000.0, 0, 'f', 3)
+                           .toUtf8());
+        }
+
+        if (buffer->dropped > 0) {
+            writeEvent(QString("{\"ph\":\"C\",\"name\":\"dropped spans\",\"pid\":%1,\"tid\":%2,"
+                               "\"ts\":0,\"args\":{\"dropped\":%3}}")
+                           .arg(pid).arg(buffer->tid).arg(buffer->dropped).toUtf8());
+        }
+    }
+
+    file.write("\n]}\n");
+    return file.error() == QFileDevice::NoError;
+}
+
+Span::Span(const char* name) noexcept
+    : m_name(name)
+    , m_startNs(isEnabled() ? nowNs() : -1)
+{
+}
+
+Span::~Span()
+{
+    if (m_startNs < 0) {
+        return;
+    }
+
+    const qint64 endNs = nowNs();
+    ThreadBuffer& buffer = localBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (buffer.events.size() < MAX_EVENTS_PER_THREAD) {
+        buffer.events.push_back({m_name, m_startNs, endNs - m_startNs});
+    } else {
+        ++buffer.dropped;
+    }
+}
+
+} // namespace rules::trace
@@ -0,0 +1,125 @@
+#include "window_aggregator.h"
+
+#include <algorithm>
+
+namespace rules {
+
+namespace {
+
+// Keys idle for longer than every window have nothing left to report
+qint64 longestWindowMs(const std::vector<WindowSpec>& windows)
+{
+    qint64 longest = 0;
+    for (const WindowSpec& window : windows) {
+        longest = std::max(longest, window.lengthMs);
+    }
+    return longest;
+}
+
+} // namespace
+
+WindowAggregator::WindowAggregator(std::vector<WindowSpec> windows, size_t maxKeys,
+                                   qint64 startMs, qint64 tickMs)
+    : m_windows(std::move(windows))
+    , m_keys(longestWindowMs(m_windows), maxKeys, startMs, tickMs)
+{
+    for (WindowSpec& window : m_windows) {
+        window.lengthMs = std::max<qint64>(window.lengthMs, 1);
+        window.buckets = window.kind == WindowKind::Tumbling
+            ? 1
+            : static_cast<int>(std::clamp<qint64>(window.buckets, 1, window.lengthMs));
+
+        m_bucketOffset.push_back(m_bucketsPerKey);
+        m_bucketWidthMs.push_back(window.lengthMs / window.buckets);
+        m_bucketsPerKey += static_cast<size_t>(window.buckets);
+    }
+}
+
+int WindowAggregator::windowIndex(const QString& name) const
+{
+    for (size_t i = 0; i < m_windows.size(); ++i) {
+        if (m_windows[i].name == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void WindowAggregator::add(const QString& key, double value, qint64 timestampMs)
+{
+    bool created = false;
+    const quint32 slot = m_keys.use(key, timestampMs, &created);
+    if (created) {
+        if (m_buckets.size() < m_keys.slotCount() * m_bucketsPerKey) {
+            m_buckets.resize(m_keys.slotCount() * m_bucketsPerKey);
+        }
+        std::fill_n(bucketsOf(slot), m_bucketsPerKey, Bucket());
+    }
+
+    Bucket* buckets = bucketsOf(slot);
+    for (size_t w = 0; w < m_windows.size(); ++w) {
+        const qint64 index = timestampMs / m_bucketWidthMs[w];
+        Bucket& bucket = buckets[m_bucketOffset[w] + static_cast<size_t>(index % m_windows[w].buckets)];
+
+        if (bucket.index > index) {
+            continue;  // the slot already holds a newer period: too late for this window
+        }
+        if (bucket.index < index) {
+            bucket = Bucket{index, 0, 0, 0, 0};
+        }
+
+        if (bucket.count == 0) {
+            bucket.min = value;
+            bucket.max = value;
+        } else {
+            bucket.min = std::min(bucket.min, value);
+            bucket.max = std::max(bucket.max, value);
+        }
+        bucket.sum += value;
+        ++bucket.count;
+    }
+}
+
+WindowStats WindowAggregator::stats(const QString& key, int window, qint64 nowMs) const
+{
+    WindowStats result;
+    const quint32 slot = m_keys.find(key);
+    if (slot == BoundedLru::NONE || window < 0 || window >= static_cast<int>(m_windows.size())) {
+        return result;
+    }
+
+    const auto w = static_cast<size_t>(window);
+    const int bucketCount = m_windows[w].buckets;
+    const qint64 newest = nowMs / m_bucketWidthMs[w];
+    const Bucket* buckets = bucketsOf(slot) + m_bucketOffset[w];
+
+    for (int i = 0; i < bucketCount; ++i) {
+        const Bucket& bucket = buckets[i];
+        if (bucket.count == 0 || bucket.index > newest || bucket.index <= newest - bucketCount) {
+            continue;
+        }
+        if (result.count == 0) {
+            result.min = bucket.min;
+            result.max = bucket.max;
+        } else {
+            result.min = std::min(result.min, bucket.min);
+            result.max = std::max(result.max, bucket.max);
+        }
+        result.count += bucket.count;
+        result.sum += bucket.sum;
+    }
+    return result;
+}
+
+void WindowAggregator::advance(qint64 nowMs)
+{
+    m_keys.advance(nowMs);  // buckets are reset when a slot is reused
+}
+
+size_t WindowAggregator::memoryBytes() const
+{
+    // Excludes the key strings' own character data
+    return m_keys.memoryBytes() + m_buckets.capacity() * sizeof(Bucket);
+}
+
+} // namespace rules
@@ -0,0 +1,113 @@
+#include "work_stealing_pool.h"
+
+#include <QThread>
+
+namespace rules {
+
+namespace {
+
+// Which pool and worker the current thread belongs to, if any
+thread_local const WorkStealingPool* t_pool = nullptr;
+thread_local int t_worker = -1;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(int threads)
+{
+    if (threads <= 0) {
+        threads = qMax(1, QThread::idealThreadCount());
+    }
+
+    m_workers.reserve(static_cast<size_t>(threads));
+    for (int i = 0; i < threads; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    m_threads.reserve(static_cast<size_t>(threads));
+    for (int i = 0; i < threads; ++i) {
+        m_threads.emplace_back([this, i]() { run(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task)
+{
+    const int index = t_pool == this
+        ? t_worker
+        : static_cast<int>(m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size());
+
+    Worker& worker = *m_workers[static_cast<size_t>(index)];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+
+    // Pairs with the sleeper's increment-then-check: either it sees the
+    // task or we see it sleeping and wake it
+    m_queued.fetch_add(1);
+    if (m_sleeping.load() > 0) {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_wake.notify_one();
+    }
+}
+
+bool WorkStealingPool::take(int index, Task& task)
+{
+    {
+        Worker& own = *m_workers[static_cast<size_t>(index)];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    const size_t count = m_workers.size();
+    for (size_t step = 1; step < count; ++step) {
+        Worker& victim = *m_workers[(static_cast<size_t>(index) + step) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            m_stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(int index)
+{
+    t_pool = this;
+    t_worker = index;
+
+    for (;;) {
+        Task task;
+        if (take(index, task)) {
+            m_queued.fetch_sub(1);
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleeping.fetch_add(1);
+        m_wake.wait(lock, [this]() { return m_stopping || m_queued.load() > 0; });
+        m_sleeping.fetch_sub(1);
+        if (m_stopping && m_queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+} // namespace rules
@@ -0,0 +1,205 @@
+/**
+ * @brief Behaviour checks for the rule condition language
+ *
+ * Built with -DRULES_PLUGIN_BUILD_TESTS=ON and run by ctest. Covers what
+ * the benchmarks cannot see: precedence, constant folding, short-circuit
+ * jumps, register reuse and the compile limits.
+ */
+
+#include "rule_expression.h"
+
+#include <QtTest>
+#include <algorithm>
+#include <vector>
+
+using namespace rules::expr;
+
+namespace {
+
+// Compiles against a fresh table; fields x, y, s read from `values` by name
+struct Compiled {
+    FieldTable fields;
+    CompileResult result;
+
+    explicit Compiled(const QString& source) : result(compile(source, fields)) {}
+
+    QVariant run(const QVariantMap& values = {}) const
+    {
+        std::vector<Value> slots(static_cast<size_t>(std::max(fields.size(), 1)));
+        for (int slot = 0; slot < fields.size(); ++slot) {
+            slots[static_cast<size_t>(slot)] = Value::fromVariant(values.value(fields.path(slot)));
+        }
+        return result.program->evaluate(slots.data()).toVariant();
+    }
+};
+
+// "x == 1 || x == 2 || ... || x == links"
+QString membership(int links)
+{
+    QStringList terms;
+    for (int i = 1; i <= links; ++i) {
+        terms << QStringLiteral("x == %1").arg(i);
+    }
+    return terms.join(QStringLiteral(" || "));
+}
+
+} // namespace
+
+class RuleExpressionTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void precedence_data();
+    void precedence();
+    void folding();
+    void shortCircuit();
+    void longChains();
+    void limits_data();
+    void limits();
+};
+
+void RuleExpressionTest::precedence_data()
+{
+    QTest::addColumn<QString>("source");
+    QTest::addColumn<QVariant>("expected");
+
+    QTest::newRow("mul before add") << "x + 3 * 4" << QVariant(14.0);
+    QTest::newRow("parentheses") << "(x + 3) * 4" << QVariant(20.0);
+    QTest::newRow("left associative") << "x - 3 - 1" << QVariant(-2.0);
+    QTest::newRow("modulo") << "x + 7 % 4" << QVariant(5.0);
+    QTest::newRow("unary minus binds tightest") << "-x + 3" << QVariant(1.0);
+    QTest::newRow("relational before equality") << "x < 3 == true" << QVariant(true);
+    QTest::newRow("and before or") << "x == 0 && x == 0 || x == 2" << QVariant(true);
+    QTest::newRow("or inside parentheses") << "x == 0 && (x == 0 || x == 2)" << QVariant(false);
+    QTest::newRow("not binds tightest") << "!x + 1" << QVariant();
+    QTest::newRow("string concatenation") << "s + \"b\" == 'ab'" << QVariant(true);
+    QTest::newRow("arithmetic on strings") << "s * 2" << QVariant();
+    QTest::newRow("mixed types differ") << "x == \"2\"" << QVariant(false);
+}
+
+void RuleExpressionTest::precedence()
+{
+    QFETCH(QString, source);
+    QFETCH(QVariant, expected);
+
+    const Compiled compiled(source);
+    QVERIFY2(compiled.result.program, qPrintable(compiled.result.error));
+    QCOMPARE(compiled.run({{"x", 2}, {"s", "a"}}), expected);
+}
+
+void RuleExpressionTest::folding()
+{
+    // Constant subtrees become one constant: only the return remains
+    const Compiled constant("1 + 2 * 3 == 7 && 'a' < 'b'");
+    QVERIFY(constant.result.program);
+    QCOMPARE(constant.result.program->instructionCount(), 1);
+    QCOMPARE(constant.run(), QVariant(true));
+
+    // A decided left side drops the right one, fields included
+    const Compiled decided("false && x > 1");
+    QVERIFY(decided.result.program);
+    QCOMPARE(decided.result.program->instructionCount(), 1);
+    QVERIFY(decided.result.program->fieldSlots().empty());
+    QCOMPARE(decided.run(), QVariant(false));
+
+    // An undecided constant left side leaves a truthiness test of the right
+    const Compiled undecided("true && x");
+    QVERIFY(undecided.result.program);
+    QCOMPARE(undecided.result.program->instructionCount(), 2);
+    QCOMPARE(undecided.run({{"x", 5}}), QVariant(true));
+    QCOMPARE(undecided.run({{"x", 0}}), QVariant(false));
+
+    // field > constant is a single instruction
+    const Compiled compare("x > 10 * 10");
+    QVERIFY(compare.result.program);
+    QCOMPARE(compare.result.program->instructionCount(), 2);
+    QCOMPARE(compare.run({{"x", 101}}), QVariant(true));
+}
+
+void RuleExpressionTest::shortCircuit()
+{
+    const Compiled orExpr("x > 1 || y > 1");
+    QVERIFY(orExpr.result.program);
+    QVERIFY(orExpr.result.program->disassemble().contains(QLatin1String("jt")));
+    QCOMPARE(orExpr.run({{"x", 2}}), QVariant(true));           // y unset: not reached
+    QCOMPARE(orExpr.run({{"x", 0}, {"y", 2}}), QVariant(true));
+    QCOMPARE(orExpr.run({{"x", 0}, {"y", 0}}), QVariant(false));
+
+    const Compiled andExpr("x > 1 && y > 1");
+    QVERIFY(andExpr.result.program);
+    QVERIFY(andExpr.result.program->disassemble().contains(QLatin1String("jf")));
+    QCOMPARE(andExpr.run({{"x", 0}, {"y", 2}}), QVariant(false));
+    QCOMPARE(andExpr.run({{"x", 2}, {"y", 0}}), QVariant(false));
+    QCOMPARE(andExpr.run({{"x", 2}, {"y", 2}}), QVariant(true));
+
+    // && and || yield booleans, not the deciding operand
+    QCOMPARE(Compiled("s || x").run({{"s", "text"}}), QVariant(true));
+    QCOMPARE(Compiled("x && s").run({{"x", 1}, {"s", ""}}), QVariant(false));
+}
+
+void RuleExpressionTest::longChains()
+{
+    // Flat chains hold one register however long they are, so they are
+    // bounded by the source length, not by MAX_REGISTERS
+    for (int links : {Program::MAX_REGISTERS + 1, 200}) {
+        const Compiled orChain(membership(links));
+        QVERIFY2(orChain.result.program, qPrintable(orChain.result.error));
+        QCOMPARE(orChain.run({{"x", links}}), QVariant(true));
+        QCOMPARE(orChain.run({{"x", links + 1}}), QVariant(false));
+
+        QString andChain = membership(links);
+        andChain.replace(QLatin1String("||"), QLatin1String("&&")).replace(QLatin1String("=="), QLatin1String("!="));
+        const Compiled compiled(andChain);
+        QVERIFY2(compiled.result.program, qPrintable(compiled.result.error));
+        QCOMPARE(compiled.run({{"x", 0}}), QVariant(true));
+        QCOMPARE(compiled.run({{"x", 1}}), QVariant(false));
+    }
+
+    // Right-nested chains too
+    QString nested = QStringLiteral("x == 40");
+    for (int i = 39; i >= 1; --i) {
+        nested = QStringLiteral("x == %1 || (%2)").arg(i).arg(nested);
+    }
+    const Compiled compiled(nested);
+    QVERIFY2(compiled.result.program, qPrintable(compiled.result.error));
+    QCOMPARE(compiled.run({{"x", 40}}), QVariant(true));
+}
+
+void RuleExpressionTest::limits_data()
+{
+    QTest::addColumn<QString>("source");
+    QTest::addColumn<QString>("error");
+
+    // Each level keeps its left product in a register while the right
+    // side is evaluated
+    QString registers = QStringLiteral("(x + 1)");
+    for (int i = 0; i < Program::MAX_REGISTERS + 8; ++i) {
+        registers = QStringLiteral("(x + 1) * (%1)").arg(registers);
+    }
+
+    QTest::newRow("registers") << registers << "expression too deeply nested";
+    QTest::newRow("parentheses")
+        << QString(Program::MAX_NESTING + 1, QLatin1Char('(')) + "x" + QString(Program::MAX_NESTING + 1, QLatin1Char(')'))
+        << "nested deeper than";
+    QTest::newRow("unary operators") << QString(Program::MAX_NESTING + 1, QLatin1Char('!')) + "x"
+                                     << "nested deeper than";
+    QTest::newRow("source length") << membership(Program::MAX_SOURCE_LENGTH / 8) << "longer than";
+    QTest::newRow("unterminated string") << "s == 'abc" << "unterminated string";
+    QTest::newRow("trailing tokens") << "x 1" << "unexpected '1'";
+    QTest::newRow("missing parenthesis") << "(x + 1" << "expected ')'";
+}
+
+void RuleExpressionTest::limits()
+{
+    QFETCH(QString, source);
+    QFETCH(QString, error);
+
+    const Compiled compiled(source);
+    QVERIFY(!compiled.result.program);
+    QVERIFY2(compiled.result.error.contains(error), qPrintable(compiled.result.error));
+}
+
+QTEST_GUILESS_MAIN(RuleExpressionTest)
+
+#include "rule_expression_test.moc"
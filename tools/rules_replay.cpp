@@ -0,0 +1,176 @@
+/**
+ * @brief Headless replay of recorded EventBus traffic
+ *
+ * Feeds a recording made with MPF_RULES_RECORD_FILE (or
+ * DemoService::startRecording) back into the plugin's event handlers and
+ * reports throughput and per-event handler latency. With --results the
+ * per-event outcome is written out; --compare diffs it against the
+ * results of another build.
+ *
+ *   rules-replay recording.bin [--speed N | --flat-out]
+ *                [--prefix demo/rules/] [--results out.tsv] [--compare baseline.tsv]
+ */
+
+#include "demo_service.h"
+#include "event_message_model.h"
+#include "event_recorder.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+using namespace rules;
+
+namespace {
+
+struct Outcome {
+    bool accepted = false;
+    size_t digest = 0;
+};
+
+QString formatOutcome(quint64 seq, const Outcome& outcome)
+{
+    return QString("%1\t%2\t%3").arg(seq).arg(outcome.accepted ? 1 : 0).arg(outcome.digest, 16, 16, QChar('0'));
+}
+
+qint64 percentile(std::vector<qint64> sorted, double p)
+{
+    if (sorted.empty()) return 0;
+    auto index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+    std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(index), sorted.end());
+    return sorted[index];
+}
+
+int compareResults(const QStringList& current, const QString& baselinePath, QTextStream& out)
+{
+    QFile file(baselinePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        out << "Cannot open baseline " << baselinePath << "\n";
+        return 2;
+    }
+
+    const QStringList baseline = QString::fromUtf8(file.readAll()).split('\n', Qt::SkipEmptyParts);
+    qsizetype differences = qAbs(baseline.size() - current.size());
+    qsizetype shown = 0;
+    for (qsizetype i = 0; i < std::min(baseline.size(), current.size()); ++i) {
+        if (baseline.at(i) == current.at(i)) continue;
+        ++differences;
+        if (shown++ < 20) {
+            out << "  - " << baseline.at(i) << "\n  + " << current.at(i) << "\n";
+        }
+    }
+
+    out << "Result diff vs " << baselinePath << ": " << differences << " differing events"
+        << (baseline.size() != current.size() ? " (event counts differ)" : "") << "\n";
+    return differences == 0 ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("rules-replay");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replay recorded EventBus traffic through the rules plugin handlers");
+    parser.addHelpOption();
+    parser.addPositionalArgument("recording", "Event log written by EventRecorder");
+    QCommandLineOption speedOption("speed", "Replay at N times the recorded pace (default 1).", "N", "1");
+    QCommandLineOption flatOutOption("flat-out", "Ignore recorded timing and replay as fast as possible.");
+    QCommandLineOption prefixOption("prefix", "Topic prefix the handler accepts.", "prefix", "demo/rules/");
+    QCommandLineOption resultsOption("results", "Write per-event outcomes to this file.", "file");
+    QCommandLineOption compareOption("compare", "Diff outcomes against a results file from another build.", "file");
+    parser.addOptions({speedOption, flatOutOption, prefixOption, resultsOption, compareOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(2);
+    }
+
+    EventLogReader reader(parser.positionalArguments().first());
+    if (!reader.isOpen()) {
+        out << "Not a readable event log: " << parser.positionalArguments().first() << "\n";
+        return 2;
+    }
+
+    const bool flatOut = parser.isSet(flatOutOption);
+    const double speed = std::max(parser.value(speedOption).toDouble(), 1e-6);
+
+    DemoService handler("com.biiz.rules");
+    handler.setTopicPrefix(parser.value(prefixOption));
+
+    bool accepted = false;
+    QObject::connect(&handler, &DemoService::messagesChanged, [&accepted]() { accepted = true; });
+
+    std::vector<qint64> latencies;
+    QStringList outcomes;
+    qint64 handlerNs = 0;
+
+    QElapsedTimer wall;
+    wall.start();
+
+    RecordedEvent event;
+    while (reader.next(event)) {
+        if (!flatOut) {
+            const auto dueNs = static_cast<qint64>(event.offsetNs / speed);
+            const qint64 waitNs = dueNs - wall.nsecsElapsed();
+            if (waitNs > 0) {
+                QThread::usleep(static_cast<unsigned long>(waitNs / 1000));
+            }
+        }
+
+        accepted = false;
+        QElapsedTimer timer;
+        timer.start();
+        handler.onEventReceived(event.topic, event.data, event.senderId);
+        const qint64 elapsed = timer.nsecsElapsed();
+
+        handlerNs += elapsed;
+        latencies.push_back(elapsed);
+
+        // Outcome: whether the handler kept the event, and what it stored
+        Outcome outcome;
+        outcome.accepted = accepted;
+        if (accepted) {
+            const QAbstractItemModel* model = handler.messageModel();
+            const QModelIndex newest = model->index(0, 0);
+            outcome.digest = qHashMulti(0, newest.data(EventMessageModel::TopicRole).toString(),
+                                        newest.data(EventMessageModel::SenderIdRole).toString(),
+                                        newest.data(EventMessageModel::MessageRole).toString(),
+                                        handler.messageCount());
+        }
+        outcomes.append(formatOutcome(static_cast<quint64>(outcomes.size()), outcome));
+    }
+
+    const double wallSeconds = wall.nsecsElapsed() / 1e9;
+    const auto count = static_cast<qint64>(latencies.size());
+    out << "Replayed " << count << " events in " << QString::number(wallSeconds, 'f', 3) << " s"
+        << (flatOut ? QString(" (flat-out)") : QString(" (%1x)").arg(speed)) << "\n"
+        << "Throughput: " << QString::number(count / std::max(wallSeconds, 1e-9), 'f', 0) << " events/s wall, "
+        << QString::number(count / std::max(handlerNs / 1e9, 1e-9), 'f', 0) << " events/s in handler\n"
+        << "Handler latency (ns): p50 " << percentile(latencies, 0.50)
+        << ", p99 " << percentile(latencies, 0.99)
+        << ", max " << (latencies.empty() ? 0 : *std::max_element(latencies.begin(), latencies.end())) << "\n";
+
+    if (parser.isSet(resultsOption)) {
+        QFile file(parser.value(resultsOption));
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            file.write(outcomes.join('\n').toUtf8());
+            file.write("\n");
+        }
+    }
+
+    if (parser.isSet(compareOption)) {
+        return compareResults(outcomes, parser.value(compareOption), out);
+    }
+    return 0;
+}